@@ -5,103 +5,139 @@
 #include "FXObjects/LBFX.cpp"
 #include "daisysp.h"
 #include "FXObjects/BassPedalFX.h"
+#include "FXObjects/LBFXChain.h"
+#include "FXObjects/BassPedalEngine.h"
+#include "FXObjects/LBProfiler.h"
+
+// Uncomment to time every audio block and print WCET/percentiles per mode over the USB log
+// #define BASSPEDAL_PROFILE
 
 using namespace daisy;
 
 DaisySeed hw;
-LB_EnvDetector inputLevelDetector;
-FatPunch fatPunch;
-MelodyMode melodyMode;
+
+// Settings kept in QSPI flash across power cycles
+struct PedalSettings {
+    float calibratedGain;
+
+    bool operator==(const PedalSettings& other) const { return calibratedGain == other.calibratedGain; }
+    bool operator!=(const PedalSettings& other) const { return !(*this == other); }
+};
+PersistentStorage<PedalSettings> settingsStorage(hw.qspi);
+const size_t kAudioBlockSize = 4;
+const SaiHandle::Config::SampleRate kAudioSampleRate = SaiHandle::Config::SampleRate::SAI_48KHZ; //32, 48 or 96kHz
+
+// Everything but the hardware: effects, presets, tuner, auto gain, hum canceller (BassPedalEngine.h)
+BassPedalEngine<kAudioBlockSize> pedal;
+float sampleRate;
+
 Switch fatButton, darkButton, punchButton, melodyButton;
 Led fatLED, darkLED, punchLED, melodyLED;
 RgbLed inLevelLED;
 
-enum fpModeNum {fat, darken, punchComp};
-bool fpModes[3] = {false, false, false};
-bool prevFatButtonState, prevDarkButtonState, 
-    prevPunchButtonState, prevMelodyButtonState = false;
+// Footswitch holds: fat toggles the hum canceller, darken steps to the next preset,
+// punch starts auto gain calibration, melody toggles tuner mode
+const float kHoldMs = 1000.0;
+
+#ifdef BASSPEDAL_PROFILE
+// One histogram per mode combination: fat, darken, punch, melody, tuner bits
+const int kNumProfileModes = 32;
+LB_BlockProfiler<kNumProfileModes> blockProfiler;
+
+void resetProfiler()
+{
+    // budget = cycles in one block period
+    blockProfiler.reset((uint32_t)((double)SystemCoreClock * kAudioBlockSize / sampleRate));
+}
+
+void printProfile()
+{
+    hw.PrintLine("budget %lu cycles/block", blockProfiler.getBudget());
+    for (int mode = 0; mode < kNumProfileModes; mode++) {
+        if (blockProfiler.getCount(mode) == 0) continue;
+        hw.PrintLine("mode %2d: n=%lu p50=%lu p99=%lu p99.9=%lu max=%lu overruns=%lu", mode,
+            blockProfiler.getCount(mode), blockProfiler.getPercentile(mode, 50.0f),
+            blockProfiler.getPercentile(mode, 99.0f), blockProfiler.getPercentile(mode, 99.9f),
+            blockProfiler.getMax(mode), blockProfiler.getOverruns(mode));
+    }
+}
+#endif
 
 
 static void Callback(AudioHandle::InterleavingInputBuffer  in,
                      AudioHandle::InterleavingOutputBuffer out,
                      size_t                                size)
 {
+#ifdef BASSPEDAL_PROFILE
+    uint32_t blockStart = DWT->CYCCNT;
+#endif
     //size is buffer size (# of samples in buffer)
-    // Read input level knob value
-    float knobVal = hw.adc.GetFloat(0);
-    float inputGain_dB = knobVal  * 84.0 - 60.0; //map knobVal 0-1 to dB gain amount -60dB to +24dB
+    PedalControls controls;
+    controls.inputTrim = hw.adc.GetFloat(0);
+    controls.mix = hw.adc.GetFloat(1);
+    controls.fatFreq = hw.adc.GetFloat(2);
+    controls.darken = hw.adc.GetFloat(3);
+    controls.midFreq = hw.adc.GetFloat(4);
+    controls.sub = hw.adc.GetFloat(5);
 
     // Debounce buttons
-    fatButton.Debounce();
-    darkButton.Debounce();
-    punchButton.Debounce();
-    melodyButton.Debounce();
-
-    // Update FX Object parameters. Button dictates fpParams param, which dictates LED state
-    FatPunchParameters fpParams = fatPunch.getParameters();
-    fpParams.fatOn = (fatButton.Pressed() && !prevFatButtonState) ? !fpParams.fatOn : fpParams.fatOn;
-    fpParams.darkenOn = (darkButton.Pressed() && !prevDarkButtonState) ? !fpParams.darkenOn : fpParams.darkenOn;
-    fpParams.punchCompOn = (punchButton.Pressed() && !prevPunchButtonState) ? !fpParams.punchCompOn : fpParams.punchCompOn;
-    fpParams.inDistAmt = 1.0; 
-    fatPunch.setParameters(fpParams);
-
-    //Set melody mode object parameter based on melody button
-    MelodyModeParameters mmParams = melodyMode.getParameters();
-    mmParams.on = (melodyButton.Pressed() && !prevMelodyButtonState) ? !mmParams.on : mmParams.on;
-    melodyMode.setParameters(mmParams);
-
-    //turn everything else off if melody mode is on
-    if (mmParams.on) {
-        fpParams.fatOn = false;
-        fpParams.darkenOn = false;
-        fpParams.punchCompOn = false;
+    Switch* buttons[numFootswitches] = {&fatButton, &darkButton, &punchButton, &melodyButton};
+    for (int i = 0; i < numFootswitches; i++) {
+        buttons[i]->Debounce();
+        controls.pressed[i] = buttons[i]->Pressed();
+        controls.timeHeldMs[i] = buttons[i]->TimeHeldMs();
     }
 
-    //Set LEDs based on mode
-    fatLED.Set(float(fpParams.fatOn));
-    darkLED.Set(float(fpParams.darkenOn));
-    punchLED.Set(float(fpParams.punchCompOn));
-    melodyLED.Set(float(mmParams.on));
+    PedalDisplay display;
+    pedal.processBlock(in, out, size, controls, display);
 
     //Update LEDs
+    fatLED.Set(display.leds[fsFat]);
+    darkLED.Set(display.leds[fsDark]);
+    punchLED.Set(display.leds[fsPunch]);
+    melodyLED.Set(display.leds[fsMelody]);
+    inLevelLED.SetColor(display.inLevel);
     fatLED.Update();
     darkLED.Update();
     punchLED.Update();
     melodyLED.Update();
-    inLevelLED.Update(); 
-
-    // AUDIO PROCESSING
-    double inputSample, inputLevel;
-    float inputLevelSum = 0.0;
-    for (size_t i = 0; i < size; i += 2) {
-        //Apply input gain
-        inputSample = in[i] * knobVal * 5;
-
-        // Read input level, output to rgb LED
-        inputLevel = inputLevelDetector.processAudioSample(inputSample); 
-        if (i == 0)
-            inLevelLED.SetColor(getLEDColor(inputLevel));
-
-        // Process audio through fatPunch object
-        out[i] = fatPunch.processAudioSample(inputSample);
-        
-        out[i] = melodyMode.processAudioSample(out[i]);
-        out[i+1] = out[i]; //interleaved output
-    } 
-
-    prevFatButtonState = fatButton.Pressed();
-    prevDarkButtonState = darkButton.Pressed();
-    prevPunchButtonState = punchButton.Pressed();
-    prevMelodyButtonState = melodyButton.Pressed();
+    inLevelLED.Update();
+
+#ifdef BASSPEDAL_PROFILE
+    blockProfiler.record(pedal.getMode(), DWT->CYCCNT - blockStart);
+#endif
+}
+
+// Main loop only. Switches the codec rate, recalculates every object for it and (re)starts audio
+bool audioRunning = false;
+void changeSampleRate(SaiHandle::Config::SampleRate rate)
+{
+    if (audioRunning)
+        hw.StopAudio();
+    hw.SetAudioSampleRate(rate);
+    sampleRate = hw.AudioSampleRate();
+
+    pedal.setSampleRate(sampleRate);
+#ifdef BASSPEDAL_PROFILE
+    resetProfiler();
+#endif
+
+    hw.StartAudio(Callback);
+    audioRunning = true;
 }
 
 int main(void)
 {
     //Initialize hardware board
-    float sampleRate;
     hw.Configure();
     hw.Init();
-    hw.SetAudioBlockSize(4);
+
+    // Flush denormals to zero, so filter/envelope tails decaying into silence don't cost extra.
+    // FPSCR covers this thread; interrupt handlers (the audio callback) start from FPDSCR
+    __set_FPSCR(__get_FPSCR() | (1 << 24)); //FZ bit
+    FPU->FPDSCR |= FPU_FPDSCR_FZ_Msk;
+    hw.SetAudioBlockSize(kAudioBlockSize);
+    hw.SetAudioSampleRate(kAudioSampleRate);
     sampleRate = hw.AudioSampleRate();
 
     //Initialize LEDs
@@ -111,33 +147,26 @@ int main(void)
     melodyLED.Init(hw.GetPin(10), false);
     inLevelLED.Init(hw.GetPin(13), hw.GetPin(12), hw.GetPin(11), false);
 
-    //Initialize input level detector
-    inputLevelDetector.reset(sampleRate);
-    LB_EnvDetectorParameters inDetectorParams = inputLevelDetector.getParameters();
-    inDetectorParams.attackTime = 50.0;
-    inDetectorParams.releaseTime = 50.0;
-    inDetectorParams.detect_dB = true;
-    inputLevelDetector.setParameters(inDetectorParams);
-
-    //Initialize fatPunch object -- equivalent to [daisySP filter].init()
-    fatPunch.reset(sampleRate);
-    FatPunchParameters fatPunchParams;
-    fatPunchParams.fatOn = false;
-    fatPunchParams.darkenOn = false;
-    fatPunchParams.punchCompOn = false;
-    fatPunchParams.inDistAmt = fatPunchParams.punchCompOn ? 4.0 : 1.5; //currently these vals are NOT getting sent to the distortion function.
-    fatPunch.setParameters(fatPunchParams);
-
-    //Initialize melodyMode object -- equivalent to [daisySP filter].init()
-    melodyMode.reset(sampleRate);
-    MelodyModeParameters mmParams;
-    mmParams.on = false;
-    melodyMode.setParameters(mmParams);
-
-    //Initialize knob
-    AdcChannelConfig adcConfig;
-    adcConfig.InitSingle(hw.GetPin(21));
-    hw.adc.Init(&adcConfig, 1);
+    //Initialize effects, presets, tuner, auto gain, hum canceller and limiter
+    pedal.init(sampleRate);
+    for (int i = 0; i < numFootswitches; i++)
+        pedal.footswitches[i].holdMs = kHoldMs;
+
+    //Load the last calibration, falls back to the uncalibrated default the first time
+    PedalSettings defaultSettings;
+    defaultSettings.calibratedGain = pedal.autoGain.getCalibratedGain();
+    settingsStorage.Init(defaultSettings);
+    pedal.autoGain.setCalibratedGain(settingsStorage.GetSettings().calibratedGain);
+
+    //Initialize knobs: input level, mix, fat freq, darken amount, melody mid freq, sub level
+    AdcChannelConfig adcConfig[6];
+    adcConfig[0].InitSingle(hw.GetPin(21));
+    adcConfig[1].InitSingle(hw.GetPin(22));
+    adcConfig[2].InitSingle(hw.GetPin(15));
+    adcConfig[3].InitSingle(hw.GetPin(16));
+    adcConfig[4].InitSingle(hw.GetPin(17));
+    adcConfig[5].InitSingle(hw.GetPin(18));
+    hw.adc.Init(adcConfig, 6);
     hw.adc.Start();
     
     //Initialize buttons
@@ -146,6 +175,38 @@ int main(void)
     punchButton.Init(hw.GetPin(26), 1000);
     melodyButton.Init(hw.GetPin(25), 1000);
     
-    hw.StartAudio(Callback);
-    while(1) {}
+#ifdef BASSPEDAL_PROFILE
+    // DWT cycle counter for block timing
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    resetProfiler();
+    hw.StartLog();
+    uint32_t lastProfilePrint = System::GetNow();
+#endif
+
+    // Boot option: hold the fat button while powering up to run at 96kHz instead of kAudioSampleRate
+    for (int i = 0; i < 50; i++) {
+        fatButton.Debounce();
+        System::Delay(1);
+    }
+    pedal.footswitches[fsFat].ignoreCurrentPress(fatButton.Pressed()); // the boot hold isn't a tap or a hum toggle
+    changeSampleRate(fatButton.Pressed() ? SaiHandle::Config::SampleRate::SAI_96KHZ : kAudioSampleRate);
+    while(1) {
+#ifdef BASSPEDAL_PROFILE
+        if (System::GetNow() - lastProfilePrint > 5000) {
+            printProfile();
+            lastProfilePrint = System::GetNow();
+        }
+#endif
+
+        // Preset changes and the tuner's pitch detection, a slice per pass, never in the callback
+        pedal.update();
+
+        // Flash writes are slow, so a finished calibration is saved from here, not the callback
+        if (pedal.autoGain.takeNewCalibration()) {
+            settingsStorage.GetSettings().calibratedGain = pedal.autoGain.getCalibratedGain();
+            settingsStorage.Save();
+        }
+    }
 }
\ No newline at end of file
@@ -21,6 +21,50 @@ Color getLEDColor(float _inputLevel) {
     return c;
 }
 
+Color getCalibrationColor() {
+    // White while auto gain is measuring
+    Color c;
+    float b = 0.5;
+    c.Init(b, b, b);
+    return c;
+}
+
+void getTunerLEDLevels(float _cents, bool _locked, float* levels) {
+    // Takes in tuner cents deviation, gives levels for the 4 mode LEDs (left = flat, right = sharp)
+    levels[0] = levels[1] = levels[2] = levels[3] = 0.0;
+    if (!_locked) return;
+
+    if (_cents < -20) {
+        levels[0] = 1.0;
+    } else if (_cents < -5) {
+        levels[1] = 1.0;
+    } else if (_cents <= 5) {
+        //in tune
+        levels[1] = levels[2] = 1.0;
+    } else if (_cents <= 20) {
+        levels[2] = 1.0;
+    } else {
+        levels[3] = 1.0;
+    }
+}
+
+Color getTunerColor(float _cents, bool _locked) {
+    // Green when in tune, blue flat, red sharp, off when no note
+    Color c;
+    float b = 0.5;
+
+    if (!_locked) {
+        c.Init(0.0, 0.0, 0.0);
+    } else if (fabsf(_cents) <= 5) {
+        c.Init(0.0, b, 0.0);
+    } else if (_cents < 0) {
+        c.Init(0.0, 0.0, b);
+    } else {
+        c.Init(b, 0.0, 0.0);
+    }
+    return c;
+}
+
 inline double dB2Raw(double x) {
     return pow(10.0, x / 20.0);
 }
@@ -0,0 +1,311 @@
+#pragma once
+
+#include "LBFXChain.h"
+#include "BassPedalFX.h"
+#include "BassPedalPresets.h"
+
+/*
+Bass pedal engine, by Lucas Burkholder
+
+Everything the audio callback does apart from the hardware: footswitch taps/holds -> modes, knobs ->
+parameters, then auto gain -> hum canceller -> effect chain -> clean blend -> limiter (or the tuner)
+on one block. BassPedal.cpp reads the ADC and switches into PedalControls and writes PedalDisplay
+to the LEDs, the host WCET harness (test/test_wcet.cpp) runs the same code with made up controls.
+*/
+
+enum footswitchID { fsFat, fsDark, fsPunch, fsMelody, numFootswitches };
+
+// Tap (on release) / hold decoding for one footswitch. A hold fires once, while the switch is still
+// down, and the release after a hold is not a tap
+class LB_Footswitch {
+public:
+	LB_Footswitch() {}
+	~LB_Footswitch() {}
+
+	void update(bool pressed, float timeHeldMs) {
+		tapped = held = false;
+		if (pressed && timeHeldMs > holdMs && !holdHandled) {
+			held = true;
+			holdHandled = true;
+		}
+		if (!pressed && prevPressed) {
+			tapped = !holdHandled;
+			holdHandled = false;
+		}
+		prevPressed = pressed;
+	}
+
+	// a switch already down (e.g. held through power up) is neither a tap nor a hold when it's let go
+	void ignoreCurrentPress(bool pressed) {
+		prevPressed = pressed;
+		holdHandled = pressed;
+	}
+
+	bool wasTapped() { return tapped; }
+	bool wasHeld() { return held; }
+
+	float holdMs = 1000.0f;
+
+private:
+	bool prevPressed = false;
+	bool holdHandled = false;
+	bool tapped = false, held = false;
+};
+
+// One block's worth of knobs (0-1) and footswitch states
+struct PedalControls {
+	float inputTrim = 0.5f;
+	float mix = 0.0f;
+	float fatFreq = 0.5f;
+	float darken = 0.5f;
+	float midFreq = 0.5f;
+	float sub = 0.0f;
+	bool pressed[numFootswitches] = { false };
+	float timeHeldMs[numFootswitches] = { 0.0f };
+};
+
+// What the LEDs should show after a block
+struct PedalDisplay {
+	float leds[numFootswitches] = { 0.0f }; //fat, darken, punch, melody
+	Color inLevel;
+};
+
+template <size_t kBlockSize>
+class BassPedalEngine {
+public:
+	BassPedalEngine() {}
+	~BassPedalEngine() {}
+
+	// Effect chain. Every effect instance lives in fxArena, the chain order comes from a preset
+	LB_FXArena<kFXArenaBytes> fxArena;
+	IAudioSignalProcessor* fxInstances[numFX] = { nullptr };
+	LB_FXChainSwitcher fxChain;
+	FatPunch* fatPunch = nullptr;
+	MelodyMode* melodyMode = nullptr;
+	int activePreset = -1;
+	volatile int requestedPreset = 0; // set from the UI (hold darken), applied by update()
+
+	LB_EnvDetector inputLevelDetector;
+	CleanBlend cleanBlend;
+	Tuner tuner;
+	AutoGain autoGain;
+	HumCanceller humCanceller;
+	LB_Limiter outputLimiter;
+	LB_Footswitch footswitches[numFootswitches];
+
+	// Tuner mode: hold melody to enter, tap or hold again to leave. Output is muted
+	volatile bool tunerOn = false;
+
+	// Before audio starts. False if the effects don't fit in the arena
+	bool init(double _sampleRate) {
+		sampleRate = _sampleRate;
+
+		inputLevelDetector.reset(sampleRate);
+		LB_EnvDetectorParameters inDetectorParams = inputLevelDetector.getParameters();
+		inDetectorParams.attackTime = 50.0;
+		inDetectorParams.releaseTime = 50.0;
+		inDetectorParams.detect_dB = true;
+		inputLevelDetector.setParameters(inDetectorParams);
+
+		fatPunch = static_cast<FatPunch*>(getFX(fxFatPunch, fxArena, fxInstances, sampleRate));
+		melodyMode = static_cast<MelodyMode*>(getFX(fxMelodyMode, fxArena, fxInstances, sampleRate));
+		if (fatPunch == nullptr || melodyMode == nullptr) return false;
+
+		FatPunchParameters fatPunchParams;
+		fatPunchParams.fatOn = false;
+		fatPunchParams.darkenOn = false;
+		fatPunchParams.punchCompOn = false;
+		fatPunchParams.inDistAmt = fatPunchParams.punchCompOn ? 4.0 : 1.5; //currently these vals are NOT getting sent to the distortion function.
+		fatPunch->setParameters(fatPunchParams);
+
+		MelodyModeParameters mmParams;
+		mmParams.on = false;
+		melodyMode->setParameters(mmParams);
+
+		//Load default effect chain
+		loadPreset(requestedPreset, fxArena, fxInstances, fxChain, sampleRate, activePreset, requestedPreset);
+
+		cleanBlend.reset(sampleRate);
+		CleanBlendParameters cbParams;
+		cbParams.mix = 0.0;
+		cleanBlend.setParameters(cbParams);
+
+		//Hum canceller tracks 50 or 60Hz mains on its own
+		humCanceller.reset(sampleRate);
+		HumCancellerParameters humParams = humCanceller.getParameters();
+		humParams.on = true;
+		humParams.numHarmonics = 4;
+		humCanceller.setParameters(humParams);
+
+		//Output limiter, 1ms lookahead
+		outputLimiter.reset(sampleRate);
+		LB_LimiterParameters limiterParams = outputLimiter.getParameters();
+		limiterParams.ceiling_dB = -0.3;
+		limiterParams.lookahead = (int)(sampleRate * 0.001);
+		limiterParams.releaseTime = 50.0;
+		outputLimiter.setParameters(limiterParams);
+
+		tuner.reset(sampleRate);
+
+		autoGain.reset(sampleRate);
+		AutoGainParameters agParams = autoGain.getParameters();
+		agParams.blockSize = kBlockSize;
+		autoGain.setParameters(agParams);
+		return true;
+	}
+
+	// Main loop only, with audio stopped. Recalculates every object for the new rate
+	void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		inputLevelDetector.setSampleRate(sampleRate);
+		cleanBlend.setSampleRate(sampleRate);
+		tuner.reset(sampleRate);
+		autoGain.setSampleRate(sampleRate);
+		humCanceller.setSampleRate(sampleRate);
+		outputLimiter.setSampleRate(sampleRate);
+		LB_LimiterParameters limiterParams = outputLimiter.getParameters();
+		limiterParams.lookahead = (int)(sampleRate * 0.001); //keep 1ms
+		outputLimiter.setParameters(limiterParams);
+		for (int i = 0; i < numFX; i++) {
+			if (fxInstances[i] != nullptr)
+				fxInstances[i]->setSampleRate(sampleRate);
+		}
+	}
+
+	// Audio thread, once per block. in/out are interleaved stereo, size samples (left input only)
+	void processBlock(const float* in, float* out, size_t size, const PedalControls& controls, PedalDisplay& display) {
+		for (int i = 0; i < numFootswitches; i++)
+			footswitches[i].update(controls.pressed[i], controls.timeHeldMs[i]);
+
+		// Update FX Object parameters. Footswitches dictate fpParams, which dictate LED state
+		FatPunchParameters fpParams = fatPunch->getParameters();
+
+		//Fat: tap toggles fat, hold toggles the hum canceller
+		if (footswitches[fsFat].wasHeld()) {
+			HumCancellerParameters humParams = humCanceller.getParameters();
+			humParams.on = !humParams.on;
+			humCanceller.setParameters(humParams);
+		}
+		fpParams.fatOn = footswitches[fsFat].wasTapped() ? !fpParams.fatOn : fpParams.fatOn;
+
+		//Darken: tap toggles darken, hold steps to the next preset
+		if (footswitches[fsDark].wasHeld())
+			requestedPreset = (activePreset + 1) % numPresets;
+		fpParams.darkenOn = footswitches[fsDark].wasTapped() ? !fpParams.darkenOn : fpParams.darkenOn;
+
+		//Punch: tap toggles punch comp, hold starts auto gain calibration
+		if (footswitches[fsPunch].wasHeld())
+			autoGain.startCalibration();
+		fpParams.punchCompOn = footswitches[fsPunch].wasTapped() ? !fpParams.punchCompOn : fpParams.punchCompOn;
+
+		fpParams.inDistAmt = 1.0;
+		fpParams.fatFreq = controls.fatFreq; //tone knobs go straight to the coefficient tables, once per block
+		fpParams.darkenAmt = controls.darken;
+		fpParams.subLevel = controls.sub < 0.02f ? 0.0 : controls.sub; //dead zone so the sub is really off at minimum
+		fatPunch->setParameters(fpParams);
+
+		//Melody: tap toggles melody mode, hold toggles tuner mode
+		bool melodyTapped = footswitches[fsMelody].wasTapped();
+		if (footswitches[fsMelody].wasHeld())
+			tunerOn = !tunerOn;
+		if (melodyTapped && tunerOn) {
+			tunerOn = false;
+			melodyTapped = false;
+		}
+
+		MelodyModeParameters mmParams = melodyMode->getParameters();
+		mmParams.on = melodyTapped ? !mmParams.on : mmParams.on;
+		mmParams.midFreq = controls.midFreq;
+		melodyMode->setParameters(mmParams);
+
+		//Clean blend amount from the mix knob, dry lane phase matched to the multiband crossovers
+		CleanBlendParameters cbParams = cleanBlend.getParameters();
+		cbParams.mix = controls.mix;
+		cbParams.numDryPhaseStages = fatPunch->getPhaseStages(cbParams.dryPhaseFreq);
+		cleanBlend.setParameters(cbParams);
+
+		//everything else shows off while melody mode is on
+		if (mmParams.on) {
+			fpParams.fatOn = false;
+			fpParams.darkenOn = false;
+			fpParams.punchCompOn = false;
+		}
+		display.leds[fsFat] = float(fpParams.fatOn);
+		display.leds[fsDark] = float(fpParams.darkenOn);
+		display.leds[fsPunch] = float(fpParams.punchCompOn);
+		display.leds[fsMelody] = float(mmParams.on);
+
+		//Tuner mode takes over the LEDs as a cents meter
+		if (tunerOn) {
+			getTunerLEDLevels(tuner.getCents(), tuner.isLocked(), display.leds);
+			display.inLevel = getTunerColor(tuner.getCents(), tuner.isLocked());
+		}
+
+		// AUDIO PROCESSING
+		LB_FXChain* chain = fxChain.getActive();
+		// Input gain is calibrated gain * knob trim, smoothed once per block
+		double inputGain = autoGain.getBlockGain(controls.inputTrim);
+		float inputLevelSum = 0.0;
+
+		// Input conditioning on the whole block: gain, then hum notches
+		double inputBlock[kBlockSize];
+		size_t numFrames = size / 2;
+		if (numFrames > kBlockSize) numFrames = kBlockSize;
+		for (size_t n = 0; n < numFrames; n++) {
+			inputLevelSum += in[2*n] * in[2*n];
+			inputBlock[n] = in[2*n] * inputGain;
+		}
+		humCanceller.processBlock(inputBlock, numFrames);
+
+		for (size_t i = 0; i < 2 * numFrames; i += 2) {
+			double inputSample = inputBlock[i/2];
+
+			// Tuner mode: feed the pitch detector, mute the output
+			if (tunerOn) {
+				tuner.pushAudioSample(inputSample);
+				out[i] = out[i+1] = 0.0;
+				continue;
+			}
+
+			// Input level to the rgb LED
+			double inputLevel = inputLevelDetector.processAudioSample(inputSample);
+			if (i == 0)
+				display.inLevel = autoGain.isCalibrating() ? getCalibrationColor() : getLEDColor(inputLevel);
+
+			// Effect chain (fatPunch -> melodyMode by default), clean low end blended back in, then
+			// brickwall limit so EQ boosts + makeup gain can't clip the codec
+			double yn = chain->processAudioSample(inputSample);
+			yn = cleanBlend.processAudioSample(inputSample, yn);
+			out[i] = outputLimiter.processAudioSample(yn);
+			out[i+1] = out[i]; //interleaved output
+		}
+
+		// Loudness measurement for auto gain, block mean square (pre gain)
+		if (numFrames > 0)
+			autoGain.measureBlock(inputLevelSum / numFrames);
+	}
+
+	// Main loop. Preset changes and the tuner's pitch detection, never in the callback
+	void update() {
+		if (requestedPreset != activePreset)
+			loadPreset(requestedPreset, fxArena, fxInstances, fxChain, sampleRate, activePreset, requestedPreset);
+
+		if (tunerOn) {
+			if (!tunerWasOn)
+				tuner.clear();
+			tuner.update();
+		}
+		tunerWasOn = tunerOn;
+	}
+
+	// fat, darken, punch, melody, tuner bits, one profiler histogram each
+	int getMode() {
+		FatPunchParameters fpParams = fatPunch->getParameters();
+		return int(fpParams.fatOn) | int(fpParams.darkenOn) << 1 | int(fpParams.punchCompOn) << 2
+			| int(melodyMode->getParameters().on) << 3 | int(tunerOn) << 4;
+	}
+
+private:
+	double sampleRate = 48000;
+	bool tunerWasOn = false;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include "LBFX.h"
 #include "../BassPedalFunctions.h"
 
@@ -14,6 +15,9 @@ struct FatPunchParameters {
 		punchCompOn = params.punchCompOn;
 		fatOn = params.fatOn;
 		darkenOn = params.darkenOn;
+		fatFreq = params.fatFreq;
+		darkenAmt = params.darkenAmt;
+		subLevel = params.subLevel;
 
 		return *this;
 	}
@@ -22,6 +26,12 @@ struct FatPunchParameters {
 	bool punchCompOn = true;
 	bool fatOn = true;
 	bool darkenOn = true;
+
+	//tone controls, 0-1 (knob position)
+	double fatFreq = 0.5;   //fat EQ center, 50-200Hz log
+	double darkenAmt = 0.5; //darken shelf cut, 0 to -28dB
+
+	double subLevel = 0.0; //sub octave mix in fat mode, 0 = off (sub knob)
 };
 struct MelodyModeParameters {
 	MelodyModeParameters() {}
@@ -29,10 +39,102 @@ struct MelodyModeParameters {
 	MelodyModeParameters& operator=(const MelodyModeParameters& params) {
 		if (this == &params) return *this;
 		on = params.on;
+		midFreq = params.midFreq;
 		return *this;
 	}
 
 	bool on = false;
+	double midFreq = 0.5; //mid EQ center, 0-1 (knob position), 559-2236Hz log
+};
+struct AutoGainParameters {
+	AutoGainParameters() {}
+
+	AutoGainParameters& operator=(const AutoGainParameters& params) {
+		if (this == &params) return *this;
+		target_dB = params.target_dB;
+		gate_dB = params.gate_dB;
+		calibrationTime = params.calibrationTime;
+		smoothingTime = params.smoothingTime;
+		blockSize = params.blockSize;
+		trimRange_dB = params.trimRange_dB;
+		trimDeadZone = params.trimDeadZone;
+		return *this;
+	}
+
+	double target_dB = -32.0;      //RMS level everything downstream is tuned for (-40 to -25dB)
+	double gate_dB = -60.0;        //blocks quieter than this (before gain) don't count as playing
+	double calibrationTime = 3.0;  //seconds of playing to measure
+	double smoothingTime = 50.0;   //ms, gain changes
+	int blockSize = 4;             //audio block size in frames
+	double trimRange_dB = 12.0;    //gain knob trims +-this much around the calibrated gain
+	double trimDeadZone = 0.05;    //knob this close to centre is exactly the calibrated gain
+};
+struct EnvelopeFilterParameters {
+	EnvelopeFilterParameters() {}
+
+	EnvelopeFilterParameters& operator=(const EnvelopeFilterParameters& params) {
+		if (this == &params) return *this;
+		fMin = params.fMin;
+		fMax = params.fMax;
+		Q = params.Q;
+		sensitivity = params.sensitivity;
+		attackTime = params.attackTime;
+		releaseTime = params.releaseTime;
+		mode = params.mode;
+		return *this;
+	}
+
+	double fMin = 200.0;       //cutoff with no signal
+	double fMax = 2000.0;      //cutoff at full sweep
+	double Q = 4.0;
+	double sensitivity = 10.0; //RMS envelope * sensitivity = sweep position (0-1)
+	double attackTime = 10.0;  //in ms
+	double releaseTime = 150.0;
+	svfMode mode = svfBandPass;
+};
+const int kMaxHumHarmonics = 8;
+
+struct HumCancellerParameters {
+	HumCancellerParameters() {}
+
+	HumCancellerParameters& operator=(const HumCancellerParameters& params) {
+		if (this == &params) return *this;
+		on = params.on;
+		numHarmonics = params.numHarmonics;
+		Q = params.Q;
+		driftTolerance = params.driftTolerance;
+		quiet_dB = params.quiet_dB;
+		return *this;
+	}
+
+	bool on = true;
+	int numHarmonics = 4;        //notches at f0, 2f0 ... up to kMaxHumHarmonics
+	double Q = 30.0;             //of the fundamental notch, harmonics keep the same bandwidth
+	double driftTolerance = 0.01; //Hz the highest notch can be off before the notches are retuned (bandwidth is ~1.7Hz)
+	double quiet_dB = -45.0;     //only track while the input is below this (between notes)
+};
+const int kMaxBlendPhaseStages = kNumCompBands - 1;
+
+struct CleanBlendParameters {
+	CleanBlendParameters() {}
+
+	CleanBlendParameters& operator=(const CleanBlendParameters& params) {
+		if (this == &params) return *this;
+		mix = params.mix;
+		fc = params.fc;
+		numDryPhaseStages = params.numDryPhaseStages;
+		for (int i = 0; i < kMaxBlendPhaseStages; i++)
+			dryPhaseFreq[i] = params.dryPhaseFreq[i];
+		return *this;
+	}
+
+	double mix = 0.0; //0 = all wet, 1 = clean low end under the wet highs
+	double fc = 120.0;
+
+	//2nd order all pass stages (Q 0.707) the wet chain puts on the low end, e.g. LR4 crossovers.
+	//The dry lane gets the same ones so it stays in phase with the wet highs through the split
+	int numDryPhaseStages = 0;
+	double dryPhaseFreq[kMaxBlendPhaseStages] = { 0.0 };
 };
 /*
 
@@ -42,7 +144,7 @@ By: Lucas Burkholder
 
 */
 
-class FatPunch {
+class FatPunch : public IAudioSignalProcessor {
 public:
 	FatPunch() {}
 	~FatPunch() {}
@@ -51,13 +153,29 @@ public:
 		lpeq.reset(_sampleRate);
 		hsf.reset(_sampleRate);
 		compressor.reset(_sampleRate);
+		subOctave.reset(_sampleRate);
+		subOctave.setParameters(subOctave.getParameters());
+		buildToneTables(_sampleRate);
+		updateTone();
 		return true;
 	}
 
+	virtual void setSampleRate(double _sampleRate) {
+		compressor.setSampleRate(_sampleRate);
+		subOctave.setSampleRate(_sampleRate);
+		buildToneTables(_sampleRate);
+		updateTone();
+	}
+
 	virtual double processAudioSample(double xn) {
+		// Sub octave tracks the clean input, mixed in after the distortion
+		double sub = 0.0;
+		if (parameters.fatOn && parameters.subLevel > 0.0)
+			sub = parameters.subLevel * subOctave.processAudioSample(xn);
+
 		// Step 1 - Distortion
 		if (parameters.fatOn)
-			xn = tanhWaveShaper(xn, parameters.inDistAmt); //distAmt goes 0.01-10
+			xn = tanhWaveShaper(xn, parameters.inDistAmt) + sub; //distAmt goes 0.01-10
 		// Step 2 - EQ
 		if (parameters.fatOn) {
 			xn *= dB2Raw(-6.0);
@@ -83,40 +201,57 @@ public:
 		return parameters;
 	}
 
+	// all pass stages this puts on the low end (for CleanBlend's dry lane): the multiband
+	// compressor's crossovers sum to one 2nd order all pass each. Returns how many, fills freqs
+	int getPhaseStages(double* allpassFreqs) {
+		if (!parameters.punchCompOn) return 0;
+		LB_MultibandCompressorParameters compressorParams = compressor.getParameters();
+		for (int i = 0; i < kNumCompBands - 1; i++)
+			allpassFreqs[i] = compressorParams.crossoverFreq[i];
+		return kNumCompBands - 1;
+	}
+
 	void setParameters(const FatPunchParameters& _parameters) {
-		if (parameters.inDistAmt != _parameters.inDistAmt 
+		bool modeChanged = parameters.inDistAmt != _parameters.inDistAmt
 			|| parameters.punchCompOn != _parameters.punchCompOn
 			|| parameters.fatOn != _parameters.fatOn
-			|| parameters.darkenOn != _parameters.darkenOn ) {
+			|| parameters.darkenOn != _parameters.darkenOn;
+		bool toneChanged = parameters.fatFreq != _parameters.fatFreq
+			|| parameters.darkenAmt != _parameters.darkenAmt
+			|| parameters.subLevel != _parameters.subLevel;
+
+		if (modeChanged || toneChanged) {
 			parameters = _parameters;
 		}
 		else return;
 
 		//clamp any parameter values here (like Q >= 0)
 		if (parameters.inDistAmt == 0) parameters.inDistAmt = 0.01;
+		if (parameters.subLevel < 0.0) parameters.subLevel = 0.0;
 
-		//update sub-object parameters here
-		LB_PEQParameters lpeqParams = lpeq.getParameters();
-		lpeqParams.fc = 100; //was 75
-		lpeqParams.gain = 8.0;
-		lpeqParams.Q = 0.4;
-		lpeq.setParameters(lpeqParams);
+		//tone knobs only touch the EQ coefficients, from the tables
+		updateTone();
+		if (!modeChanged) return;
 
-		LB_HSFParameters hsfParams = hsf.getParameters();
-		hsfParams.fc = 700.0;
-		hsfParams.gain = -14.0;
-		hsf.setParameters(hsfParams);
-
-		LB_CompressorParameters compressorParams = compressor.getParameters();
-		compressorParams.attackTime = 150.0;
-		compressorParams.releaseTime = 20.0;
-		compressorParams.ratio = 3.0;
-		compressorParams.threshold_dB = -42.0; //39.1 //assumes peaking around -5 -10dB
+		//update sub-object parameters here
+		// Multiband so the low fundamental doesn't pump the string attack.
+		// Low band gets squashed the hardest, upper bands are lighter and slower so the attack comes through
+		LB_MultibandCompressorParameters compressorParams = compressor.getParameters();
+		compressorParams.crossoverFreq[0] = 150.0;
+		compressorParams.crossoverFreq[1] = 600.0;
+		compressorParams.crossoverFreq[2] = 2500.0;
+		const double threshold_dB[kNumCompBands] = { -44.0, -46.0, -48.0, -50.0 }; //assumes peaking around -5 -10dB
+		const double ratio[kNumCompBands] = { 3.0, 2.5, 2.0, 1.5 };
+		const double attackTime[kNumCompBands] = { 150.0, 100.0, 60.0, 40.0 };
+		const double releaseTime[kNumCompBands] = { 20.0, 30.0, 40.0, 60.0 };
+		for (int i = 0; i < kNumCompBands; i++) {
+			compressorParams.threshold_dB[i] = threshold_dB[i];
+			compressorParams.ratio[i] = ratio[i];
+			compressorParams.attackTime[i] = attackTime[i];
+			compressorParams.releaseTime[i] = releaseTime[i];
+		}
 		compressorParams.outputGain = 3.0;
 		compressor.setParameters(compressorParams);
-
-		//update filter coefficients here? 
-		//don't have to bc [filter].setParameters() does it
 	}
 
 protected:
@@ -125,10 +260,34 @@ protected:
 	LB_PEQ lpeq;
 	LB_HSF hsf;
 
-	LB_Compressor compressor;
+	LB_MultibandCompressor compressor;
+	LB_SubOctave subOctave;
+
+	// fat EQ swept by frequency, darken shelf swept by gain. Both within 0.005dB of an exact design (test/test_coefftable)
+	LB_CoeffTable<LB_PEQ, LB_PEQParameters, 32, 1> lpeqTable;
+	LB_CoeffTable<LB_HSF, LB_HSFParameters, 1, 64> hsfTable;
+
+	void buildToneTables(double sampleRate) {
+		LB_PEQParameters lpeqParams;
+		lpeqParams.gain = 8.0;
+		lpeqParams.Q = 0.4;
+		lpeqTable.build(sampleRate, lpeqParams, 50.0, 200.0, lpeqParams.gain, lpeqParams.gain);
+
+		LB_HSFParameters hsfParams;
+		hsfParams.fc = 700.0;
+		hsfTable.build(sampleRate, hsfParams, hsfParams.fc, hsfParams.fc, 0.0, -28.0);
+	}
+
+	void updateTone() {
+		double coeffs[numCoeffs];
+		lpeqTable.lookup(parameters.fatFreq, 0.0, coeffs);
+		lpeq.setCoefficients(coeffs);
+		hsfTable.lookup(0.0, parameters.darkenAmt, coeffs);
+		hsf.setCoefficients(coeffs);
+	}
 };
 
-class MelodyMode {
+class MelodyMode : public IAudioSignalProcessor {
 public:
 	MelodyMode() {}
 	~MelodyMode() {}
@@ -136,9 +295,17 @@ public:
 		//reset all member fx objects here
 		midEQ.reset(sampleRate);
 		hiEQ.reset(sampleRate);
+		buildToneTables(sampleRate);
+		updateTone();
 		return true;
 	}
 
+	virtual void setSampleRate(double sampleRate) {
+		hiEQ.setSampleRate(sampleRate);
+		buildToneTables(sampleRate);
+		updateTone();
+	}
+
 	virtual double processAudioSample(double xn) {
 		//processing here
 		//this ASSUMES input signal is within ideal range of -40dB to -25dB
@@ -170,20 +337,21 @@ public:
 	}
 
 	void setParameters(const MelodyModeParameters& _parameters) {
-		if (parameters.on != _parameters.on) {
+		bool modeChanged = parameters.on != _parameters.on;
+		bool toneChanged = parameters.midFreq != _parameters.midFreq;
+
+		if (modeChanged || toneChanged) {
 			parameters = _parameters;
 		}
 		else return;
 
 		//clamp any parameters here
 
-		//update sub-object parameters here
-		LB_PEQParameters midEQParams = midEQ.getParameters();
-		midEQParams.fc = 1118.0;
-		midEQParams.gain = 10.0;
-		midEQParams.Q = 0.3;
-		midEQ.setParameters(midEQParams);
+		//mid knob only touches the mid EQ coefficients, from the table
+		updateTone();
+		if (!modeChanged) return;
 
+		//update sub-object parameters here
 		LB_PEQParameters hiEQParams = hiEQ.getParameters();
 		hiEQParams.fc = 4763.0;
 		hiEQParams.gain = 5.9;
@@ -191,10 +359,25 @@ public:
 		hiEQ.setParameters(hiEQParams);
 	}
 
-private:
+protected:
 	MelodyModeParameters parameters;
 	LB_PEQ midEQ, hiEQ;
 
+	LB_CoeffTable<LB_PEQ, LB_PEQParameters, 32, 1> midEQTable;
+
+	void buildToneTables(double sampleRate) {
+		LB_PEQParameters midEQParams;
+		midEQParams.gain = 10.0;
+		midEQParams.Q = 0.3;
+		midEQTable.build(sampleRate, midEQParams, 559.0, 2236.0, midEQParams.gain, midEQParams.gain);
+	}
+
+	void updateTone() {
+		double coeffs[numCoeffs];
+		midEQTable.lookup(parameters.midFreq, 0.0, coeffs);
+		midEQ.setCoefficients(coeffs);
+	}
+
 	double waveShaper(double x) {
 		float k = 5.4;
 		double num = tanh(k * x * 1.33) * 0.35;
@@ -203,3 +386,635 @@ private:
 	}
 
 };
+
+/*
+
+Envelope filter (auto-wah): TPT SVF swept by the input envelope.
+Sweep position is picked once per control block, g comes out of a table of tan() and is
+ramped linearly sample to sample, so there is no tan in the callback.
+
+By: Lucas Burkholder
+
+*/
+
+class EnvelopeFilter : public IAudioSignalProcessor {
+public:
+	EnvelopeFilter() {}
+	~EnvelopeFilter() {}
+
+	virtual bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		detector.reset(_sampleRate);
+		svf.reset(_sampleRate);
+		countdown = 0;
+		updateSubObjects();
+		g = gTable[0];
+		gStep = 0.0;
+		return true;
+	}
+
+	virtual void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		detector.setSampleRate(_sampleRate);
+		svf.setSampleRate(_sampleRate);
+		updateSubObjects();
+	}
+
+	virtual double processAudioSample(double xn) {
+		double env = detector.processAudioSample(xn);
+
+		if (--countdown <= 0) {
+			// sweep position -> g, linear interp in the table
+			double pos = env * parameters.sensitivity;
+			if (pos > 1.0) pos = 1.0;
+			pos *= kTableSize - 1;
+			int i = (int)pos;
+			if (i > kTableSize - 2) i = kTableSize - 2;
+			double target = gTable[i] + (pos - i) * (gTable[i + 1] - gTable[i]);
+
+			gStep = (target - g) / kControlInterval;
+			countdown = kControlInterval;
+		}
+
+		g += gStep;
+		svf.setG(g);
+		return svf.processAudioSample(xn);
+	}
+
+	virtual bool canProcessAudioFrame() { return false; }
+
+	EnvelopeFilterParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(const EnvelopeFilterParameters& _parameters) {
+		parameters = _parameters;
+
+		//clamp
+		if (parameters.fMin < 20.0) parameters.fMin = 20.0;
+		if (parameters.fMax < parameters.fMin) parameters.fMax = parameters.fMin;
+		if (parameters.fMax > 0.4 * sampleRate) parameters.fMax = 0.4 * sampleRate;
+
+		updateSubObjects();
+	}
+
+private:
+	static const int kTableSize = 64;
+	static const int kControlInterval = 4; //samples
+
+	EnvelopeFilterParameters parameters;
+	double sampleRate = 48000;
+
+	LB_EnvDetector detector;
+	LB_SVF svf;
+
+	double gTable[kTableSize]; //tan(pi * fc / fs), fc log spaced fMin to fMax
+	double g = 0.0;
+	double gStep = 0.0;
+	int countdown = 0;
+
+	void updateSubObjects() {
+		LB_EnvDetectorParameters detectorParams = detector.getParameters();
+		detectorParams.attackTime = parameters.attackTime;
+		detectorParams.releaseTime = parameters.releaseTime;
+		detectorParams.detect_dB = false;
+		detector.setParameters(detectorParams);
+
+		LB_SVFParameters svfParams = svf.getParameters();
+		svfParams.fc = parameters.fMin;
+		svfParams.Q = parameters.Q;
+		svfParams.mode = parameters.mode;
+		svf.setParameters(svfParams);
+
+		for (int i = 0; i < kTableSize; i++) {
+			double fc = parameters.fMin * pow(parameters.fMax / parameters.fMin, (double)i / (kTableSize - 1));
+			gTable[i] = tan(kPi * fc / sampleRate);
+		}
+	}
+};
+
+/*
+
+Object for blending the clean low end back in under the fat/melody sound
+
+By: Lucas Burkholder
+
+*/
+
+class CleanBlend {
+public:
+	CleanBlend() {}
+	~CleanBlend() {}
+
+	virtual bool reset(double _sampleRate) {
+		for (int i = 0; i < 2; i++)
+			lowpass[i].reset(_sampleRate);
+		lpfDesign.reset(_sampleRate);
+		wetPhase.reset(_sampleRate);
+		for (int i = 0; i < kMaxBlendPhaseStages; i++)
+			dryPhase[i].reset(_sampleRate);
+		updateFilters();
+		updateDryPhase();
+		return true;
+	}
+
+	virtual void setSampleRate(double _sampleRate) {
+		lpfDesign.setSampleRate(_sampleRate);
+		wetPhase.setSampleRate(_sampleRate);
+		for (int i = 0; i < kMaxBlendPhaseStages; i++)
+			dryPhase[i].setSampleRate(_sampleRate);
+		for (int i = 0; i < 2; i++)
+			lowpass[i].setCoefficients(lpfDesign.getCoefficients());
+	}
+
+	virtual double processAudioSample(double dry, double wet) {
+		// match the phase the wet chain's own crossovers put on the low end
+		for (int i = 0; i < parameters.numDryPhaseStages; i++)
+			dry = dryPhase[i].processAudioSample(dry);
+
+		// lane 0 = dry, lane 1 = wet. Both run through the same LR4 low pass so
+		// their low bands have identical crossover phase
+		double frame[kNumBiquadLanes] = { dry, wet };
+		lowpass[0].processAudioFrame(frame);
+		lowpass[1].processAudioFrame(frame);
+
+		// all pass = LR4 low + high, so this is wet with the same phase as the split
+		double yn = wetPhase.processAudioSample(wet);
+
+		// swap the wet low band for the dry one by mix amount
+		return yn + parameters.mix * (frame[0] - frame[1]);
+	}
+
+	virtual bool canProcessAudioFrame() { return false; }
+
+	CleanBlendParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(const CleanBlendParameters& _parameters) {
+		bool fcChanged = parameters.fc != _parameters.fc;
+		bool phaseChanged = parameters.numDryPhaseStages != _parameters.numDryPhaseStages;
+		for (int i = 0; i < kMaxBlendPhaseStages; i++)
+			phaseChanged = phaseChanged || parameters.dryPhaseFreq[i] != _parameters.dryPhaseFreq[i];
+		parameters = _parameters;
+
+		//clamp
+		if (parameters.mix < 0.0) parameters.mix = 0.0;
+		if (parameters.mix > 1.0) parameters.mix = 1.0;
+		if (parameters.numDryPhaseStages < 0) parameters.numDryPhaseStages = 0;
+		if (parameters.numDryPhaseStages > kMaxBlendPhaseStages) parameters.numDryPhaseStages = kMaxBlendPhaseStages;
+
+		if (fcChanged) updateFilters();
+		if (phaseChanged) updateDryPhase();
+	}
+
+private:
+	CleanBlendParameters parameters;
+
+	LBBiquadLanes lowpass[2]; //cascaded -> LR4
+	LB_LPF lpfDesign;         //only used to calculate the butterworth coefficients
+	LB_APF wetPhase;
+	LB_APF dryPhase[kMaxBlendPhaseStages];
+
+	void updateDryPhase() {
+		for (int i = 0; i < parameters.numDryPhaseStages; i++) {
+			LB_APFParameters apfParams;
+			apfParams.fc = parameters.dryPhaseFreq[i];
+			apfParams.Q = 0.707;
+			dryPhase[i].setParameters(apfParams);
+		}
+	}
+
+	void updateFilters() {
+		LB_LPFParameters lpfParams;
+		lpfParams.fc = parameters.fc;
+		lpfParams.Q = 0.707;
+		lpfDesign.setParameters(lpfParams);
+		for (int i = 0; i < 2; i++)
+			lowpass[i].setCoefficients(lpfDesign.getCoefficients());
+
+		LB_APFParameters apfParams;
+		apfParams.fc = parameters.fc;
+		apfParams.Q = 0.707;
+		wetPhase.setParameters(apfParams);
+	}
+};
+
+/*
+
+Tuner: decimates the input in the callback, runs YIN on it in the main loop
+
+By: Lucas Burkholder
+
+*/
+
+class Tuner {
+public:
+	Tuner() {}
+	~Tuner() {}
+
+	bool reset(double _sampleRate) {
+		// decimate down to ~6kHz, still 3 periods of a low B per analysis frame
+		decimation = (int)(_sampleRate / kTargetRate + 0.5);
+		if (decimation < 1) decimation = 1;
+		decimationPhase = 0;
+
+		LB_LPFParameters aaParams;
+		aaParams.fc = 1000.0;
+		aaParams.Q = 0.707;
+		for (int i = 0; i < 2; i++) {
+			antiAlias[i].reset(_sampleRate);
+			antiAlias[i].setParameters(aaParams);
+		}
+
+		detector.reset(_sampleRate / decimation);
+		writeIndex.store(0);
+		readIndex.store(0);
+		clear();
+		return true;
+	}
+
+	// main loop only. Drops anything old, including an estimate still in progress, e.g. when entering tuner mode
+	void clear() {
+		readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+		detector.cancel();
+		memset(&history[0], 0, sizeof(float) * kYinFrameSize);
+		historyPos = 0;
+		newSamples = 0;
+		cents = 0.0f;
+		noteNum = -1;
+		lockCount = 0;
+	}
+
+	// audio thread, every input sample
+	void pushAudioSample(double xn) {
+		double filtered = antiAlias[1].processAudioSample(antiAlias[0].processAudioSample(xn));
+		if (++decimationPhase < decimation) return;
+		decimationPhase = 0;
+
+		uint32_t w = writeIndex.load(std::memory_order_relaxed);
+		ring[w & (kRingSize - 1)] = (float)filtered;
+		writeIndex.store(w + 1, std::memory_order_release);
+	}
+
+	// main loop. Pulls decimated samples and does a small slice of pitch detection
+	void update() {
+		uint32_t r = readIndex.load(std::memory_order_relaxed);
+		uint32_t w = writeIndex.load(std::memory_order_acquire);
+		for (; r != w; r++) {
+			history[historyPos] = ring[r & (kRingSize - 1)];
+			if (++historyPos >= kYinFrameSize) historyPos = 0;
+			newSamples++;
+		}
+		readIndex.store(r, std::memory_order_release);
+
+		if (!detector.isBusy()) {
+			if (newSamples < kHopSize) return;
+			newSamples = 0;
+
+			// unroll circular history, oldest first
+			float frame[kYinFrameSize];
+			for (int i = 0; i < kYinFrameSize; i++)
+				frame[i] = history[(historyPos + i) % kYinFrameSize];
+			detector.startAnalysis(frame);
+		}
+
+		if (detector.processChunk(kLagsPerUpdate))
+			updateReading();
+	}
+
+	float getCents() { return cents; } //deviation from nearest note
+
+	int getNoteNum() { return noteNum; } //MIDI note, -1 if none
+
+	bool isLocked() { return lockCount >= kLockEstimates; }
+
+private:
+	static constexpr double kTargetRate = 6000.0;
+	static const int kRingSize = 1024; //power of 2
+	static const int kHopSize = 128;   //new estimate every ~21ms
+	static const int kLagsPerUpdate = 32;
+	static const int kLockEstimates = 2;
+	static constexpr double kMinClarity = 0.8;
+
+	LB_LPF antiAlias[2];
+	int decimation = 8;
+	int decimationPhase = 0;
+
+	float ring[kRingSize];
+	std::atomic<uint32_t> writeIndex{0};
+	std::atomic<uint32_t> readIndex{0};
+
+	float history[kYinFrameSize];
+	int historyPos = 0;
+	int newSamples = 0;
+
+	LB_PitchDetector detector;
+
+	float cents = 0.0f;
+	int noteNum = -1;
+	int lockCount = 0;
+
+	void updateReading() {
+		double f = detector.getFrequency();
+		if (f <= 0.0 || detector.getClarity() < kMinClarity) {
+			lockCount = 0;
+			return;
+		}
+
+		double note = 69.0 + 12.0 * log2(f / 440.0);
+		int nearest = (int)floor(note + 0.5);
+		float newCents = (float)((note - nearest) * 100.0);
+
+		// agrees with the last reading -> count toward lock and smooth, otherwise start over
+		if (nearest == noteNum && fabsf(newCents - cents) < 15.0f) {
+			if (lockCount < kLockEstimates) lockCount++;
+			cents = 0.5f * (cents + newCents);
+		}
+		else {
+			lockCount = 1;
+			noteNum = nearest;
+			cents = newCents;
+		}
+	}
+};
+
+/*
+
+Automatic input gain staging. Measures the player's loudness over a few seconds of playing, then
+sets the input gain so the signal sits at the level the rest of the chain assumes.
+Everything here is once per block: mean square accumulation while calibrating, gain smoothing after.
+
+By: Lucas Burkholder
+
+*/
+
+class AutoGain {
+public:
+	AutoGain() {}
+	~AutoGain() {}
+
+	bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		calibrating = false;
+		currentGain = calibratedGain;
+		updateCoeffs();
+		return true;
+	}
+
+	void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		updateCoeffs();
+	}
+
+	AutoGainParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(const AutoGainParameters& _parameters) {
+		parameters = _parameters;
+		if (parameters.blockSize < 1) parameters.blockSize = 1;
+		parameters.trimDeadZone = fmin(fmax(parameters.trimDeadZone, 0.0), 0.45);
+		lastTrimKnob = -1.0;
+		updateCoeffs();
+	}
+
+	void startCalibration() {
+		sumMeanSquare = 0.0;
+		activeBlocks = 0;
+		calibrating = true;
+	}
+
+	bool isCalibrating() { return calibrating; }
+
+	// audio thread, once per block. meanSquare is the block's mean square before any gain
+	void measureBlock(double meanSquare) {
+		if (!calibrating || meanSquare < gateMeanSquare) return;
+
+		sumMeanSquare += meanSquare;
+		if (++activeBlocks < calibrationBlocks) return;
+
+		// done - one log/pow for the whole calibration
+		double level_dB = 10.0 * log10(sumMeanSquare / activeBlocks);
+		calibratedGain = pow(10.0, (parameters.target_dB - level_dB) / 20.0);
+		calibrating = false;
+		newCalibration = true;
+	}
+
+	// main loop. True once after each finished calibration, e.g. to save the result
+	bool takeNewCalibration() {
+		if (!newCalibration) return false;
+		newCalibration = false;
+		return true;
+	}
+
+	// audio thread, once per block. trimKnob 0-1 trims the calibrated gain by -trimRange_dB to
+	// +trimRange_dB, centre (within the dead zone) = as calibrated
+	double getBlockGain(double trimKnob) {
+		if (trimKnob != lastTrimKnob) {
+			lastTrimKnob = trimKnob;
+			trimGain = getTrimGain(trimKnob);
+		}
+		currentGain += smoothingCoeff * (calibratedGain * trimGain - currentGain);
+		return currentGain;
+	}
+
+	double getTrimGain(double trimKnob) {
+		double offset = trimKnob - 0.5;
+		double distance = fabs(offset) - parameters.trimDeadZone;
+		if (distance <= 0.0) return 1.0;
+		double trim_dB = parameters.trimRange_dB * fmin(distance / (0.5 - parameters.trimDeadZone), 1.0);
+		return dB2Raw(offset < 0.0 ? -trim_dB : trim_dB);
+	}
+
+	double getCalibratedGain() { return calibratedGain; }
+
+	// restores a saved calibration, before audio starts. Ignores values no calibration could produce
+	void setCalibratedGain(double gain) {
+		if (!(gain > kMinGain && gain < kMaxGain)) return;
+		calibratedGain = gain;
+		currentGain = gain;
+	}
+
+private:
+	AutoGainParameters parameters;
+	double sampleRate = 48000;
+
+	static constexpr double kMinGain = 1e-3;
+	static constexpr double kMaxGain = 1e4;
+
+	double calibratedGain = 2.5; //uncalibrated default, the old knob * 5 mapping at half knob
+	double currentGain = 2.5;
+	double lastTrimKnob = -1.0;
+	double trimGain = 1.0;
+	double smoothingCoeff = 1.0;
+
+	bool calibrating = false;
+	volatile bool newCalibration = false;
+	double sumMeanSquare = 0.0;
+	int activeBlocks = 0;
+	int calibrationBlocks = 1;
+	double gateMeanSquare = 0.0;
+
+	void updateCoeffs() {
+		double blockRate = sampleRate / parameters.blockSize;
+		smoothingCoeff = 1.0 - exp(-1.0 / (parameters.smoothingTime * 0.001 * blockRate));
+		calibrationBlocks = (int)(parameters.calibrationTime * blockRate);
+		if (calibrationBlocks < 1) calibrationBlocks = 1;
+		gateMeanSquare = pow(10.0, parameters.gate_dB / 10.0);
+	}
+};
+
+/*
+
+Mains hum canceller. Tracks the mains fundamental (45-65Hz, covers 50 and 60Hz mains) and notches
+out its first N harmonics with one SOS cascade run on the whole input block.
+
+Tracking is a zero crossing period estimator on a band passed copy of the input, only updated while
+the player is quiet and the 45-65Hz band holds most of the energy, so bass notes can't drag it.
+Notch coefficients are only recalculated when the highest notch would be off by more than driftTolerance.
+
+By: Lucas Burkholder
+
+*/
+
+class HumCanceller {
+public:
+	HumCanceller() {}
+	~HumCanceller() {}
+
+	bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		notches.reset(_sampleRate);
+		notchDesign.reset(_sampleRate);
+
+		LB_SVFParameters bpParams;
+		bpParams.fc = 55.0;
+		bpParams.Q = 1.5;
+		bpParams.mode = svfBandPass;
+		humBand.reset(_sampleRate);
+		humBand.setParameters(bpParams);
+
+		LB_EnvDetectorParameters envParams;
+		envParams.attackTime = 5.0;
+		envParams.releaseTime = 200.0;
+		envParams.detect_dB = false;
+		inputEnv.reset(_sampleRate);
+		inputEnv.setParameters(envParams);
+		humEnv.reset(_sampleRate);
+		humEnv.setParameters(envParams);
+
+		prevBand = 0.0;
+		samplesSinceCrossing = -1.0;
+		updateNotches();
+		return true;
+	}
+
+	void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		notchDesign.setSampleRate(_sampleRate);
+		humBand.setSampleRate(_sampleRate);
+		inputEnv.setSampleRate(_sampleRate);
+		humEnv.setSampleRate(_sampleRate);
+		samplesSinceCrossing = -1.0;
+		updateNotches();
+	}
+
+	HumCancellerParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(const HumCancellerParameters& _parameters) {
+		bool enabling = !parameters.on && _parameters.on;
+		parameters = _parameters;
+
+		//notch state is stale after a bypass
+		if (enabling) notches.reset(sampleRate);
+
+		//clamp
+		if (parameters.numHarmonics < 1) parameters.numHarmonics = 1;
+		if (parameters.numHarmonics > kMaxHumHarmonics) parameters.numHarmonics = kMaxHumHarmonics;
+		if (parameters.Q <= 0.0) parameters.Q = 30.0;
+		quietLevel = pow(10.0, parameters.quiet_dB / 20.0);
+
+		updateNotches();
+	}
+
+	// in place, whole input block. Tracking keeps running while bypassed so switching back on starts locked
+	void processBlock(double* block, int numSamples) {
+		for (int n = 0; n < numSamples; n++)
+			trackSample(block[n]);
+
+		if (!parameters.on) return;
+
+		if (fabs(trackedFreq - notchFreq) * parameters.numHarmonics > parameters.driftTolerance)
+			updateNotches();
+
+		notches.processBlock(block, numSamples);
+	}
+
+	double getTrackedFreq() { return trackedFreq; }
+
+private:
+	static constexpr double kMinMainsFreq = 45.0;
+	static constexpr double kMaxMainsFreq = 65.0;
+	static constexpr double kTrackingRate = 0.02; //per measured cycle
+
+	HumCancellerParameters parameters;
+	double sampleRate = 48000;
+
+	LB_SOSCascade<kMaxHumHarmonics> notches;
+	LB_Notch notchDesign; //only used to calculate coefficients
+	double notchFreq = 60.0;
+	double trackedFreq = 60.0;
+
+	LB_SVF humBand;
+	LB_EnvDetector inputEnv, humEnv;
+	double quietLevel = 0.0056;
+	double prevBand = 0.0;
+	double samplesSinceCrossing = -1.0; //-1 = no crossing yet
+
+	void trackSample(double xn) {
+		double band = humBand.processAudioSample(xn);
+		double inputLevel = inputEnv.processAudioSample(xn);
+		double humLevel = humEnv.processAudioSample(band);
+
+		bool tracking = inputLevel < quietLevel && humLevel > 0.5 * inputLevel;
+		if (!tracking) {
+			samplesSinceCrossing = -1.0;
+			prevBand = band;
+			return;
+		}
+
+		if (samplesSinceCrossing >= 0.0) samplesSinceCrossing += 1.0;
+
+		// positive going zero crossing, interpolated to a fraction of a sample
+		if (prevBand < 0.0 && band >= 0.0) {
+			double frac = band / (band - prevBand); //how far before this sample it crossed
+			if (samplesSinceCrossing > 0.0) {
+				double measured = sampleRate / (samplesSinceCrossing - frac);
+				if (measured > kMinMainsFreq && measured < kMaxMainsFreq)
+					trackedFreq += kTrackingRate * (measured - trackedFreq);
+			}
+			samplesSinceCrossing = frac;
+		}
+		prevBand = band;
+	}
+
+	void updateNotches() {
+		notchFreq = trackedFreq;
+
+		int numSections = 0;
+		for (int h = 1; h <= parameters.numHarmonics; h++) {
+			double fc = h * notchFreq;
+			if (fc > 0.45 * sampleRate) break;
+
+			LB_NotchParameters notchParams;
+			notchParams.fc = fc;
+			notchParams.Q = parameters.Q * h; //same bandwidth at every harmonic
+			notchDesign.setParameters(notchParams);
+			notches.setSectionCoefficients(numSections++, notchDesign.getCoefficients());
+		}
+		notches.setNumSections(numSections);
+	}
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "LBFXChain.h"
+#include "BassPedalFX.h"
+
+/*
+Effect presets, by Lucas Burkholder
+
+Every effect instance lives in an LB_FXArena, created the first time a preset needs it. A preset is
+just the chain order. The arena, instance table and chain switcher are passed in so the firmware and
+the host tests run the same code.
+*/
+
+const size_t kFXArenaBytes = 16 * 1024;
+
+enum fxID { fxFatPunch, fxMelodyMode, fxEnvFilter, numFX };
+
+struct FXPreset {
+	int length;
+	fxID order[kMaxChainLength];
+};
+
+const FXPreset presets[] = {
+	{ 2, { fxFatPunch, fxMelodyMode } }, // default
+	{ 2, { fxMelodyMode, fxFatPunch } },
+	{ 3, { fxFatPunch, fxEnvFilter, fxMelodyMode } }, // auto-wah
+};
+const int numPresets = sizeof(presets) / sizeof(presets[0]);
+
+// Returns the instance for an effect, creating it in the arena the first time. nullptr if it doesn't fit
+template <size_t kArenaBytes>
+IAudioSignalProcessor* getFX(fxID id, LB_FXArena<kArenaBytes>& arena, IAudioSignalProcessor* (&instances)[numFX],
+	double sampleRate) {
+	if (id < 0 || id >= numFX) return nullptr;
+
+	if (instances[id] == nullptr) {
+		IAudioSignalProcessor* fx = nullptr;
+		switch (id) {
+			case fxFatPunch: fx = arena.template create<FatPunch>(); break;
+			case fxMelodyMode: fx = arena.template create<MelodyMode>(); break;
+			case fxEnvFilter: fx = arena.template create<EnvelopeFilter>(); break;
+			default: break;
+		}
+		if (fx == nullptr) return nullptr;
+		fx->reset(sampleRate);
+		instances[id] = fx;
+	}
+	return instances[id];
+}
+
+// Main loop only. Builds the preset's chain off to the side, then swaps it in.
+// On failure the active chain is left alone and the request is dropped (requestedPreset = activePreset),
+// so the main loop doesn't retry forever
+template <size_t kArenaBytes>
+bool loadPreset(int presetNum, LB_FXArena<kArenaBytes>& arena, IAudioSignalProcessor* (&instances)[numFX],
+	LB_FXChainSwitcher& fxChain, double sampleRate, int& activePreset, volatile int& requestedPreset) {
+	bool ok = presetNum >= 0 && presetNum < numPresets;
+
+	LB_FXChain* next = fxChain.beginEdit();
+	for (int i = 0; ok && i < presets[presetNum].length; i++)
+		ok = next->append(getFX(presets[presetNum].order[i], arena, instances, sampleRate));
+
+	if (!ok) {
+		next->clear();
+		requestedPreset = activePreset;
+		return false;
+	}
+	fxChain.commit(next);
+	activePreset = presetNum;
+	return true;
+}
@@ -16,6 +16,24 @@ double LBBiquad::processAudioSample(double xn) {
 	return yn;
 }
 
+void LBBiquadLanes::processAudioFrame(double* frame) {
+	double* z1 = &stateArray[x_z1 * kNumBiquadLanes];
+	double* z2 = &stateArray[x_z2 * kNumBiquadLanes];
+
+	// Canonical form difference eqn, every lane
+	for (int lane = 0; lane < kNumBiquadLanes; lane++) {
+		double wn = frame[lane] - coeffArray[b1] * z1[lane]
+			- coeffArray[b2] * z2[lane];
+
+		frame[lane] = coeffArray[a0] * wn
+			+ coeffArray[a1] * z1[lane]
+			+ coeffArray[a2] * z2[lane];
+
+		z2[lane] = z1[lane];
+		z1[lane] = wn;
+	}
+}
+
 double LB_LPF::processAudioSample(double xn) {
 	return biquad.processAudioSample(xn);
 }
@@ -48,6 +66,99 @@ bool LB_LPF::calculateFilterCoeffs() {
 
 }
 
+double LB_HPF::processAudioSample(double xn) {
+	return biquad.processAudioSample(xn);
+}
+
+bool LB_HPF::calculateFilterCoeffs() {
+	//clear coeff array
+	memset(&coeffArray[0], 0, sizeof(double) * numCoeffs);
+
+	// --- set default pass-through
+	coeffArray[a0] = 1.0;
+	coeffArray[c0] = 1.0;
+	coeffArray[d0] = 0.0;
+
+	//for 2nd order high pass filter
+	double thetaC = 2 * kPi * parameters.fc / sampleRate;
+	double d = 1.0 / parameters.Q;
+	double beta = 0.5 * (1 - (d / 2) * sin(thetaC)) / (1 + (d / 2) * sin(thetaC));
+	double gamma = (0.5 + beta) * cos(thetaC);
+
+	coeffArray[a0] = (0.5 + beta + gamma) / 2.0;
+	coeffArray[a1] = -(0.5 + beta + gamma);
+	coeffArray[a2] = coeffArray[a0];
+	coeffArray[b1] = -2 * gamma;
+	coeffArray[b2] = 2 * beta;
+
+	biquad.setCoefficients(coeffArray);
+
+	return true;
+
+}
+
+double LB_APF::processAudioSample(double xn) {
+	return biquad.processAudioSample(xn);
+}
+
+bool LB_APF::calculateFilterCoeffs() {
+	//clear coeff array
+	memset(&coeffArray[0], 0, sizeof(double) * numCoeffs);
+
+	// --- set default pass-through
+	coeffArray[a0] = 1.0;
+	coeffArray[c0] = 1.0;
+	coeffArray[d0] = 0.0;
+
+	//for 2nd order all pass filter, same beta/gamma as the LPF/HPF so the phase matches an LR4 pair
+	double thetaC = 2 * kPi * parameters.fc / sampleRate;
+	double d = 1.0 / parameters.Q;
+	double beta = 0.5 * (1 - (d / 2) * sin(thetaC)) / (1 + (d / 2) * sin(thetaC));
+	double gamma = (0.5 + beta) * cos(thetaC);
+
+	coeffArray[a0] = 2 * beta;
+	coeffArray[a1] = -2 * gamma;
+	coeffArray[a2] = 1.0;
+	coeffArray[b1] = -2 * gamma;
+	coeffArray[b2] = 2 * beta;
+
+	biquad.setCoefficients(coeffArray);
+
+	return true;
+
+}
+
+double LB_Notch::processAudioSample(double xn) {
+	return biquad.processAudioSample(xn);
+}
+
+bool LB_Notch::calculateFilterCoeffs() {
+	//clear coeff array
+	memset(&coeffArray[0], 0, sizeof(double) * numCoeffs);
+
+	// --- set default pass-through
+	coeffArray[a0] = 1.0;
+	coeffArray[c0] = 1.0;
+	coeffArray[d0] = 0.0;
+
+	//for 2nd order notch, same beta/gamma as the LPF
+	double thetaC = 2 * kPi * parameters.fc / sampleRate;
+	double d = 1.0 / parameters.Q;
+	double beta = 0.5 * (1 - (d / 2) * sin(thetaC)) / (1 + (d / 2) * sin(thetaC));
+	double gamma = (0.5 + beta) * cos(thetaC);
+
+	coeffArray[a0] = 0.5 + beta;
+	coeffArray[a1] = -2 * gamma;
+	coeffArray[a2] = 0.5 + beta;
+	coeffArray[b1] = -2 * gamma;
+	coeffArray[b2] = 2 * beta;
+
+	biquad.setCoefficients(coeffArray);
+
+	return true;
+
+}
+
 double LB_PEQ::processAudioSample(double xn) {
 	return coeffArray[d0] * xn + coeffArray[c0] * biquad.processAudioSample(xn);
 }
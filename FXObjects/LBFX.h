@@ -1,5 +1,6 @@
 #include <cstring>
 #include <math.h>
+#include <stdint.h>
 #pragma once
 
 enum filterCoeff { a0, a1, a2, b1, b2, c0, d0, numCoeffs };
@@ -11,6 +12,25 @@ const double kSmallestNegativeFloatValue = -1.175494351e-38;         /* min nega
 const double TLD_AUDIO_ENVELOPE_ANALOG_TC = -0.99967234081320612357829304641019; // ln(36.7%)
 const double kPi = 3.14159265358979323846;
 
+/*
+Audio signal processor interface, by Lucas Burkholder
+Anything that can be placed in an LB_FXChain
+*/
+
+class IAudioSignalProcessor {
+public:
+	virtual ~IAudioSignalProcessor() {}
+
+	virtual bool reset(double _sampleRate) = 0;
+
+	virtual double processAudioSample(double xn) = 0;
+
+	virtual bool canProcessAudioFrame() = 0;
+
+	// recalculates every coefficient / time constant for the new rate, keeps parameters
+	virtual void setSampleRate(double _sampleRate) = 0;
+};
+
 /* 
 Biquad object, by Lucas Burkholder
 */
@@ -48,6 +68,44 @@ protected:
 	double stateArray[numStates] = { 0.0, 0.0, 0.0, 0.0 };
 };
 
+/*
+Multi-lane biquad object, by Lucas Burkholder
+All lanes share one set of coefficients. State is interleaved (stateArray[reg * kNumBiquadLanes + lane])
+so one pass of the difference eqn updates every lane at once
+*/
+
+const int kNumBiquadLanes = 2;
+
+class LBBiquadLanes {
+
+public:
+
+	LBBiquadLanes() {}
+	~LBBiquadLanes() {}
+
+	bool reset(double _sampleRate) {
+		memset(&stateArray[0], 0, sizeof(double) * numStates * kNumBiquadLanes);
+		return true;
+	}
+
+	bool canProcessAudioFrame() { return true; }
+
+	//frame holds one sample per lane, processed in place
+	void processAudioFrame(double* frame);
+
+	void setCoefficients(double* coeffs) {
+		memcpy(&coeffArray[0], &coeffs[0], sizeof(double) * numCoeffs);
+	}
+
+	double* getCoefficients() {
+		return &coeffArray[0];
+	}
+
+protected:
+	double coeffArray[numCoeffs] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	double stateArray[numStates * kNumBiquadLanes] = { 0.0 };
+};
+
 
 struct LB_LPFParameters {
 	LB_LPFParameters() {}
@@ -63,6 +121,66 @@ struct LB_LPFParameters {
 	double Q = 0.707;
 };
 
+struct LB_HPFParameters {
+	LB_HPFParameters() {}
+
+	LB_HPFParameters& operator=(const LB_HPFParameters& params) {
+		if (this == &params) return *this;
+		fc = params.fc;
+		Q = params.Q;
+		return *this;
+	}
+
+	double fc = 100;
+	double Q = 0.707;
+};
+
+struct LB_APFParameters {
+	LB_APFParameters() {}
+
+	LB_APFParameters& operator=(const LB_APFParameters& params) {
+		if (this == &params) return *this;
+		fc = params.fc;
+		Q = params.Q;
+		return *this;
+	}
+
+	double fc = 1000;
+	double Q = 0.707;
+};
+
+enum svfMode { svfLowPass, svfBandPass, svfHighPass };
+
+struct LB_SVFParameters {
+	LB_SVFParameters() {}
+
+	LB_SVFParameters& operator=(const LB_SVFParameters& params) {
+		if (this == &params) return *this;
+		fc = params.fc;
+		Q = params.Q;
+		mode = params.mode;
+		return *this;
+	}
+
+	double fc = 1000;
+	double Q = 0.707;
+	svfMode mode = svfLowPass;
+};
+
+struct LB_NotchParameters {
+	LB_NotchParameters() {}
+
+	LB_NotchParameters& operator=(const LB_NotchParameters& params) {
+		if (this == &params) return *this;
+		fc = params.fc;
+		Q = params.Q;
+		return *this;
+	}
+
+	double fc = 60;
+	double Q = 30;
+};
+
 struct LB_PEQParameters {
 	LB_PEQParameters() {}
 
@@ -106,12 +224,84 @@ struct LB_CompressorParameters {
 		return *this;
 	}
 
-	double threshold_dB = threshold_dB;
-	double ratio = ratio;
-	double attackTime = attackTime; //in ms
-	double releaseTime = releaseTime;
-	double outputGain = outputGain;
+	double threshold_dB = -20.0;
+	double ratio = 4.0;
+	double attackTime = 10.0; //in ms
+	double releaseTime = 100.0;
+	double outputGain = 0.0;
+
+};
+
+struct LB_SubOctaveParameters {
+	LB_SubOctaveParameters() {}
+	LB_SubOctaveParameters& operator=(const LB_SubOctaveParameters& params) {
+		if (this == &params) return *this;
+		inputFc = params.inputFc;
+		outputFc = params.outputFc;
+		hysteresis = params.hysteresis;
+		return *this;
+	}
+
+	double inputFc = 200.0;   //isolates the fundamental before the zero crossing detector
+	double outputFc = 100.0;  //rounds off the divided square wave
+	double hysteresis = 0.3;  //schmitt trigger threshold, relative to the RMS envelope
+};
+
+const int kMaxLookahead = 256; //samples
+
+struct LB_LimiterParameters {
+	LB_LimiterParameters() {}
+	LB_LimiterParameters& operator=(const LB_LimiterParameters& params) {
+		if (this == &params) return *this;
+		ceiling_dB = params.ceiling_dB;
+		lookahead = params.lookahead;
+		releaseTime = params.releaseTime;
+		return *this;
+	}
+
+	double ceiling_dB = -0.3;
+	int lookahead = 48;         //in samples, 1 to kMaxLookahead. Also the latency
+	double releaseTime = 50.0;  //in ms
+};
+
+const int kNumCompBands = 4;
+
+struct LB_LRCrossoverParameters {
+	LB_LRCrossoverParameters() {}
+	LB_LRCrossoverParameters& operator=(const LB_LRCrossoverParameters& params) {
+		if (this == &params) return *this;
+		fc = params.fc;
+		return *this;
+	}
+
+	double fc = 200.0;
+};
+
+struct LB_MultibandCompressorParameters {
+	LB_MultibandCompressorParameters() {}
+	LB_MultibandCompressorParameters& operator=(const LB_MultibandCompressorParameters& params) {
+		if (this == &params) return *this;
+		for (int i = 0; i < kNumCompBands - 1; i++)
+			crossoverFreq[i] = params.crossoverFreq[i];
+		for (int i = 0; i < kNumCompBands; i++) {
+			threshold_dB[i] = params.threshold_dB[i];
+			ratio[i] = params.ratio[i];
+			attackTime[i] = params.attackTime[i];
+			releaseTime[i] = params.releaseTime[i];
+		}
+		outputGain = params.outputGain;
+		return *this;
+	}
+
+	//band edges, low to high
+	double crossoverFreq[kNumCompBands - 1] = { 150.0, 600.0, 2500.0 };
 
+	//per band settings, low band first
+	double threshold_dB[kNumCompBands] = { -42.0, -42.0, -42.0, -42.0 };
+	double ratio[kNumCompBands] = { 3.0, 3.0, 3.0, 3.0 };
+	double attackTime[kNumCompBands] = { 150.0, 150.0, 150.0, 150.0 }; //in ms
+	double releaseTime[kNumCompBands] = { 20.0, 20.0, 20.0, 20.0 };
+	double outputGain = 0.0; //in dB, applied after the bands are summed
 };
 
 struct LB_EnvDetectorParameters {
@@ -156,6 +346,7 @@ public:
 
 	bool reset(double _sampleRate) {
 		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
 		return biquad.reset(sampleRate);
 	}
 
@@ -168,6 +359,10 @@ public:
 
 	bool canProcessAudioFrame() { return false; }
 
+	double* getCoefficients() {
+		return &coeffArray[0];
+	}
+
 protected:
 	LBBiquad biquad;
 	double coeffArray[numCoeffs] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
@@ -178,20 +373,24 @@ protected:
 	bool calculateFilterCoeffs();
 };
 
-class LB_PEQ {
-public: 
-	LB_PEQ() {}
-	~LB_PEQ() {}
+/*
+	High Pass Filter Object, by Lucas Burkholder
+*/
 
-	LB_PEQParameters getParameters() {
+class LB_HPF {
+public:
+	LB_HPF() {}
+	~LB_HPF() {}
+
+	LB_HPFParameters getParameters() {
 		return parameters;
 	}
 
-	void setParameters(LB_PEQParameters _parameters) {
-		if (parameters.fc != _parameters.fc || parameters.Q != _parameters.Q || parameters.gain != _parameters.gain) {
-
+	void setParameters(LB_HPFParameters _parameters) {
+		if (parameters.fc != _parameters.fc || parameters.Q != _parameters.Q) {
 			parameters = _parameters;
-		} else return;
+		}
+		else return;
 
 		if (parameters.Q <= 0) parameters.Q = 0.707;
 
@@ -201,6 +400,7 @@ public:
 
 	bool reset(double _sampleRate) {
 		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
 		return biquad.reset(sampleRate);
 	}
 
@@ -216,34 +416,42 @@ public:
 protected:
 	LBBiquad biquad;
 	double coeffArray[numCoeffs] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
-	
-	LB_PEQParameters parameters;
-	double sampleRate = 44100;
 
+	LB_HPFParameters parameters;
+	double sampleRate = 48000;
 
 	bool calculateFilterCoeffs();
 };
 
-class LB_HSF {
+/*
+	2nd order All Pass Filter Object, by Lucas Burkholder
+	With Q = 0.707 this has the same phase response as an LR4 crossover (LP + HP)
+*/
+
+class LB_APF {
 public:
-	LB_HSF() {}
-	~LB_HSF() {}
+	LB_APF() {}
+	~LB_APF() {}
 
-	LB_HSFParameters getParameters() {
+	LB_APFParameters getParameters() {
 		return parameters;
 	}
 
-	void setParameters(LB_HSFParameters _parameters) {
-		if (parameters.fc != _parameters.fc || parameters.gain != _parameters.gain) {
+	void setParameters(LB_APFParameters _parameters) {
+		if (parameters.fc != _parameters.fc || parameters.Q != _parameters.Q) {
 			parameters = _parameters;
 		}
 		else return;
-		
+
+		if (parameters.Q <= 0) parameters.Q = 0.707;
+
+		//update coefficients
 		calculateFilterCoeffs();
 	}
 
 	bool reset(double _sampleRate) {
 		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
 		return biquad.reset(sampleRate);
 	}
 
@@ -260,126 +468,434 @@ protected:
 	LBBiquad biquad;
 	double coeffArray[numCoeffs] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
 
-	LB_HSFParameters parameters;
-	double sampleRate = 44100;
+	LB_APFParameters parameters;
+	double sampleRate = 48000;
+
 	bool calculateFilterCoeffs();
-	
 };
 
-class LB_EnvDetector {
+/*
+	TPT state variable filter, by Lucas Burkholder
+	Zavalishin/Simper trapezoidal integrator form. Stays stable with the cutoff changing every sample,
+	unlike retuning a biquad, so it is the one to modulate. setG() is the fast path: g = tan(pi * fc / fs)
+	worked out by the caller (e.g. from a table). All three modes are unity gain in the pass band,
+	band-pass included, so changing Q does not change the level
+*/
+
+class LB_SVF {
 public:
-	LB_EnvDetector() {}
-	~LB_EnvDetector() {}
+	LB_SVF() {}
+	~LB_SVF() {}
 
-	LB_EnvDetectorParameters getParameters() {
+	LB_SVFParameters getParameters() {
 		return parameters;
 	}
 
-	void setParameters(LB_EnvDetectorParameters _parameters) {
-		parameters = _parameters;
+	void setParameters(LB_SVFParameters _parameters) {
+		if (parameters.fc != _parameters.fc || parameters.Q != _parameters.Q || parameters.mode != _parameters.mode) {
+			parameters = _parameters;
+		}
+		else return;
 
-		setAttackTime(_parameters.attackTime, true);
-		setReleaseTime(_parameters.releaseTime, true);
+		if (parameters.Q <= 0) parameters.Q = 0.707;
+
+		calculateFilterCoeffs();
 	}
 
-	virtual bool reset(double _sampleRate) {
+	bool reset(double _sampleRate) {
 		sampleRate = _sampleRate;
-		lastEnvelope = 0.0;
+		ic1eq = ic2eq = 0.0;
+		calculateFilterCoeffs();
 		return true;
 	}
 
-	virtual double processAudioSample(double xn) {
-		//full wave rectification
-		double input = fabs(xn);
-
-		//Square it (RMS)
-		input *= input;
-
-		double currEnvelope = 0.0;
-
-		if (input > lastEnvelope)
-			currEnvelope = attackTime * (lastEnvelope - input) + input;
-		else
-			currEnvelope = releaseTime * (lastEnvelope - input) + input;
-
-		//bound here if desired
-
-		currEnvelope = fmax(currEnvelope, 0.0);
-
-		lastEnvelope = currEnvelope;
-
-		//do SQRT bc RMS
-		currEnvelope = pow(currEnvelope, 0.5);
-
-		if (!parameters.detect_dB) return currEnvelope;
+	double processAudioSample(double xn) {
+		double v3 = xn - ic2eq;
+		double v1 = a1 * ic1eq + a2 * v3;
+		double v2 = ic2eq + a2 * ic1eq + a3 * v3;
+		ic1eq = 2.0 * v1 - ic1eq;
+		ic2eq = 2.0 * v2 - ic2eq;
+
+		switch (parameters.mode) {
+			case svfBandPass: return k * v1; //unity gain at fc, raw v1 peaks at Q
+			case svfHighPass: return xn - k * v1 - v2;
+			default: return v2;
+		}
+	}
 
-		return 20.0 * log10(currEnvelope);
+	// modulation fast path, no tan. Keeps Q/mode
+	void setG(double _g) {
+		g = _g;
+		a1 = 1.0 / (1.0 + g * (g + k));
+		a2 = g * a1;
+		a3 = g * a2;
 	}
 
-	virtual void setSampleRate(double _sampleRate) {
-		if (sampleRate == _sampleRate) return;
+	void setSampleRate(double _sampleRate) {
 		sampleRate = _sampleRate;
-
-		setAttackTime(parameters.attackTime, true);
-		setReleaseTime(parameters.releaseTime, true);
+		calculateFilterCoeffs();
 	}
 
-	virtual bool canProcessAudioFrame() { return false; }
+	bool canProcessAudioFrame() { return false; }
 
 protected:
-	LB_EnvDetectorParameters parameters;
-	double sampleRate = 44100;
-	double attackTime;
-	double releaseTime;
-	double lastEnvelope;
+	LB_SVFParameters parameters;
+	double sampleRate = 48000;
 
-	void setAttackTime(double attack_ms, bool forceCalc) {
-		if (!forceCalc && parameters.attackTime == attack_ms) return;
-		parameters.attackTime = attack_ms;
-		//try this with -1?
-		attackTime = exp(TLD_AUDIO_ENVELOPE_ANALOG_TC / (attack_ms * sampleRate * 0.001));
-	}
+	double g = 0.0, k = 1.414;
+	double a1 = 0.0, a2 = 0.0, a3 = 0.0;
+	double ic1eq = 0.0, ic2eq = 0.0; //integrator states
 
-	void setReleaseTime(double release_ms, bool forceCalc) {
-		if (!forceCalc && parameters.releaseTime == release_ms) return;
-		parameters.releaseTime = release_ms;
-		releaseTime = exp(TLD_AUDIO_ENVELOPE_ANALOG_TC / (release_ms * sampleRate * 0.001));
+	void calculateFilterCoeffs() {
+		double thetaC = kPi * parameters.fc / sampleRate;
+		if (thetaC > 0.95 * kPi / 2.0) thetaC = 0.95 * kPi / 2.0; //tan(pi/2) is undefined
+		k = 1.0 / parameters.Q;
+		setG(tan(thetaC));
 	}
 };
 
-class LB_Compressor {
+/*
+	Notch Filter Object, by Lucas Burkholder
+*/
+
+class LB_Notch {
 public:
-	LB_Compressor() {}
-	~LB_Compressor() {}
+	LB_Notch() {}
+	~LB_Notch() {}
 
-	LB_CompressorParameters getParameters() {
+	LB_NotchParameters getParameters() {
 		return parameters;
 	}
 
-	void setParameters(LB_CompressorParameters _parameters) {
-		parameters = _parameters;
+	void setParameters(LB_NotchParameters _parameters) {
+		if (parameters.fc != _parameters.fc || parameters.Q != _parameters.Q) {
+			parameters = _parameters;
+		}
+		else return;
 
-		LB_EnvDetectorParameters detectorParams = detector.getParameters();
-		detectorParams.attackTime = parameters.attackTime;
-		detectorParams.releaseTime = parameters.releaseTime;
-		detector.setParameters(detectorParams);
-	}
+		if (parameters.Q <= 0) parameters.Q = 0.707;
 
-	virtual bool reset(double _sampleRate) {
-		detector.reset(_sampleRate);
-		LB_EnvDetectorParameters detectorParams = detector.getParameters();
-		detectorParams.detect_dB = true;
-		detector.setParameters(detectorParams);
-		return true;
+		//update coefficients
+		calculateFilterCoeffs();
 	}
 
-	virtual double processAudioSample(double xn) {
-		double detect_dB = detector.processAudioSample(xn); // no sidechain here yet
+	bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
+		return biquad.reset(sampleRate);
+	}
 
-		//compute gain
-		double gr = computeGain(detect_dB);
+	double processAudioSample(double xn);
 
-		//makeup gain
+	void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
+	}
+
+	bool canProcessAudioFrame() { return false; }
+
+	double* getCoefficients() {
+		return &coeffArray[0];
+	}
+
+protected:
+	LBBiquad biquad;
+	double coeffArray[numCoeffs] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+	LB_NotchParameters parameters;
+	double sampleRate = 48000;
+
+	bool calculateFilterCoeffs();
+};
+
+/*
+	Second order section cascade, by Lucas Burkholder
+	Up to kMaxSections biquads run back to back on a whole block, one section at a time
+	(section outer loop, sample inner loop) so each section's coefficients/state stay in registers
+*/
+
+template <int kMaxSections>
+class LB_SOSCascade {
+public:
+	LB_SOSCascade() {}
+	~LB_SOSCascade() {}
+
+	bool reset(double _sampleRate) {
+		memset(&stateArray[0][0], 0, sizeof(stateArray));
+		return true;
+	}
+
+	// only the a/b coefficients are used (c0/d0 wet/dry is not supported)
+	void setSectionCoefficients(int section, double* coeffs) {
+		if (section < 0 || section >= kMaxSections) return;
+		memcpy(&coeffArray[section][0], &coeffs[0], sizeof(double) * numCoeffs);
+	}
+
+	void setNumSections(int _numSections) {
+		numSections = _numSections < 0 ? 0 : (_numSections > kMaxSections ? kMaxSections : _numSections);
+	}
+
+	int getNumSections() { return numSections; }
+
+	// in place
+	void processBlock(double* block, int numSamples) {
+		for (int s = 0; s < numSections; s++) {
+			const double* c = coeffArray[s];
+			double z1 = stateArray[s][x_z1];
+			double z2 = stateArray[s][x_z2];
+
+			// Canonical form difference eqn
+			for (int n = 0; n < numSamples; n++) {
+				double wn = block[n] - c[b1] * z1 - c[b2] * z2;
+				block[n] = c[a0] * wn + c[a1] * z1 + c[a2] * z2;
+				z2 = z1;
+				z1 = wn;
+			}
+
+			stateArray[s][x_z1] = z1;
+			stateArray[s][x_z2] = z2;
+		}
+	}
+
+protected:
+	double coeffArray[kMaxSections][numCoeffs];
+	double stateArray[kMaxSections][numStates] = { { 0.0 } };
+	int numSections = 0;
+};
+
+class LB_PEQ {
+public: 
+	LB_PEQ() {}
+	~LB_PEQ() {}
+
+	LB_PEQParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(LB_PEQParameters _parameters) {
+		if (parameters.fc != _parameters.fc || parameters.Q != _parameters.Q || parameters.gain != _parameters.gain) {
+
+			parameters = _parameters;
+		} else return;
+
+		if (parameters.Q <= 0) parameters.Q = 0.707;
+
+		//update coefficients
+		calculateFilterCoeffs();
+	}
+
+	bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
+		return biquad.reset(sampleRate);
+	}
+
+	double processAudioSample(double xn);
+
+	void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
+	}
+
+	bool canProcessAudioFrame() { return false; }
+
+	double* getCoefficients() {
+		return &coeffArray[0];
+	}
+
+	// bypasses calculateFilterCoeffs, for table based coefficients
+	void setCoefficients(double* coeffs) {
+		memcpy(&coeffArray[0], &coeffs[0], sizeof(double) * numCoeffs);
+		biquad.setCoefficients(coeffArray);
+	}
+
+protected:
+	LBBiquad biquad;
+	double coeffArray[numCoeffs] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	
+	LB_PEQParameters parameters;
+	double sampleRate = 48000;
+
+
+	bool calculateFilterCoeffs();
+};
+
+class LB_HSF {
+public:
+	LB_HSF() {}
+	~LB_HSF() {}
+
+	LB_HSFParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(LB_HSFParameters _parameters) {
+		if (parameters.fc != _parameters.fc || parameters.gain != _parameters.gain) {
+			parameters = _parameters;
+		}
+		else return;
+		
+		calculateFilterCoeffs();
+	}
+
+	bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
+		return biquad.reset(sampleRate);
+	}
+
+	double processAudioSample(double xn);
+
+	void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		calculateFilterCoeffs();
+	}
+
+	bool canProcessAudioFrame() { return false; }
+
+	double* getCoefficients() {
+		return &coeffArray[0];
+	}
+
+	// bypasses calculateFilterCoeffs, for table based coefficients
+	void setCoefficients(double* coeffs) {
+		memcpy(&coeffArray[0], &coeffs[0], sizeof(double) * numCoeffs);
+		biquad.setCoefficients(coeffArray);
+	}
+
+protected:
+	LBBiquad biquad;
+	double coeffArray[numCoeffs] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+	LB_HSFParameters parameters;
+	double sampleRate = 48000;
+	bool calculateFilterCoeffs();
+	
+};
+
+class LB_EnvDetector {
+public:
+	LB_EnvDetector() {}
+	~LB_EnvDetector() {}
+
+	LB_EnvDetectorParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(LB_EnvDetectorParameters _parameters) {
+		parameters = _parameters;
+
+		setAttackTime(_parameters.attackTime, true);
+		setReleaseTime(_parameters.releaseTime, true);
+	}
+
+	virtual bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		lastEnvelope = 0.0;
+
+		setAttackTime(parameters.attackTime, true);
+		setReleaseTime(parameters.releaseTime, true);
+		return true;
+	}
+
+	virtual double processAudioSample(double xn) {
+		//full wave rectification
+		double input = fabs(xn);
+
+		//Square it (RMS)
+		input *= input;
+
+		double currEnvelope = 0.0;
+
+		if (input > lastEnvelope)
+			currEnvelope = attackTime * (lastEnvelope - input) + input;
+		else
+			currEnvelope = releaseTime * (lastEnvelope - input) + input;
+
+		//bound here if desired
+
+		currEnvelope = fmax(currEnvelope, 0.0);
+
+		lastEnvelope = currEnvelope;
+
+		//do SQRT bc RMS
+		currEnvelope = pow(currEnvelope, 0.5);
+
+		if (!parameters.detect_dB) return currEnvelope;
+
+		return 20.0 * log10(currEnvelope);
+	}
+
+	virtual void setSampleRate(double _sampleRate) {
+		if (sampleRate == _sampleRate) return;
+		sampleRate = _sampleRate;
+
+		setAttackTime(parameters.attackTime, true);
+		setReleaseTime(parameters.releaseTime, true);
+	}
+
+	virtual bool canProcessAudioFrame() { return false; }
+
+protected:
+	LB_EnvDetectorParameters parameters;
+	double sampleRate = 48000;
+	double attackTime = 0.0;
+	double releaseTime = 0.0;
+	double lastEnvelope = 0.0;
+
+	void setAttackTime(double attack_ms, bool forceCalc) {
+		if (!forceCalc && parameters.attackTime == attack_ms) return;
+		parameters.attackTime = attack_ms;
+		//try this with -1?
+		attackTime = exp(TLD_AUDIO_ENVELOPE_ANALOG_TC / (attack_ms * sampleRate * 0.001));
+	}
+
+	void setReleaseTime(double release_ms, bool forceCalc) {
+		if (!forceCalc && parameters.releaseTime == release_ms) return;
+		parameters.releaseTime = release_ms;
+		releaseTime = exp(TLD_AUDIO_ENVELOPE_ANALOG_TC / (release_ms * sampleRate * 0.001));
+	}
+};
+
+class LB_Compressor {
+public:
+	LB_Compressor() {}
+	~LB_Compressor() {}
+
+	LB_CompressorParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(LB_CompressorParameters _parameters) {
+		parameters = _parameters;
+
+		LB_EnvDetectorParameters detectorParams = detector.getParameters();
+		detectorParams.attackTime = parameters.attackTime;
+		detectorParams.releaseTime = parameters.releaseTime;
+		detector.setParameters(detectorParams);
+	}
+
+	virtual bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		detector.reset(_sampleRate);
+		LB_EnvDetectorParameters detectorParams = detector.getParameters();
+		detectorParams.detect_dB = true;
+		detector.setParameters(detectorParams);
+		return true;
+	}
+
+	virtual void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		detector.setSampleRate(_sampleRate);
+	}
+
+	virtual double processAudioSample(double xn) {
+		double detect_dB = detector.processAudioSample(xn); // no sidechain here yet
+
+		//compute gain
+		double gr = computeGain(detect_dB);
+
+		//makeup gain
 		double makeupGain = pow(10.0, parameters.outputGain / 20.0);
 		return xn * gr * makeupGain;
 	}
@@ -388,7 +904,7 @@ public:
 
 protected:
 	LB_CompressorParameters parameters;
-	double sampleRate = 44100;
+	double sampleRate = 48000;
 
 	LB_EnvDetector detector;
 
@@ -407,6 +923,646 @@ protected:
 };
 
 
+/*
+	Linkwitz-Riley (LR4) crossover, by Lucas Burkholder
+	Two cascaded butterworth LPFs / HPFs, so low + high sums to an all pass
+*/
+
+class LB_LRCrossover {
+public:
+	LB_LRCrossover() {}
+	~LB_LRCrossover() {}
+
+	LB_LRCrossoverParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(LB_LRCrossoverParameters _parameters) {
+		if (parameters.fc != _parameters.fc) {
+			parameters = _parameters;
+		}
+		else return;
+
+		updateFilters();
+	}
+
+	bool reset(double _sampleRate) {
+		for (int i = 0; i < 2; i++) {
+			lpf[i].reset(_sampleRate);
+			hpf[i].reset(_sampleRate);
+		}
+		return true;
+	}
+
+	void processAudioSample(double xn, double& low, double& high) {
+		low = lpf[1].processAudioSample(lpf[0].processAudioSample(xn));
+		high = hpf[1].processAudioSample(hpf[0].processAudioSample(xn));
+	}
+
+	void setSampleRate(double _sampleRate) {
+		for (int i = 0; i < 2; i++) {
+			lpf[i].setSampleRate(_sampleRate);
+			hpf[i].setSampleRate(_sampleRate);
+		}
+	}
+
+	bool canProcessAudioFrame() { return false; }
+
+protected:
+	LB_LRCrossoverParameters parameters;
+	LB_LPF lpf[2];
+	LB_HPF hpf[2];
+
+	void updateFilters() {
+		LB_LPFParameters lpfParams;
+		lpfParams.fc = parameters.fc;
+		lpfParams.Q = 0.707;
+		LB_HPFParameters hpfParams;
+		hpfParams.fc = parameters.fc;
+		hpfParams.Q = 0.707;
+		for (int i = 0; i < 2; i++) {
+			lpf[i].setParameters(lpfParams);
+			hpf[i].setParameters(hpfParams);
+		}
+	}
+};
+
+/*
+	Multiband compressor, by Lucas Burkholder
+
+	Splits into 4 bands with LR4 crossovers: the middle crossover splits first, then each half is
+	split again. Each half gets an all pass at the other half's crossover freq so all bands
+	line up in phase and sum back flat.
+
+	The envelope detectors and gain computers are stored structure-of-arrays (one float lane per band)
+	so the per-band loops have no branches and can be vectorized. The detector runs on the
+	mean square every sample; the gain computer only runs every kGainUpdateInterval samples
+	and the gain is ramped linearly in between, so there is no log/pow per sample.
+*/
+
+class LB_MultibandCompressor {
+public:
+	LB_MultibandCompressor() {}
+	~LB_MultibandCompressor() {}
+
+	LB_MultibandCompressorParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(LB_MultibandCompressorParameters _parameters) {
+		parameters = _parameters;
+
+		//clamp
+		for (int i = 0; i < kNumCompBands; i++)
+			if (parameters.ratio[i] < 1.0) parameters.ratio[i] = 1.0;
+
+		updateCrossovers();
+		updateLanes();
+	}
+
+	virtual bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		for (int i = 0; i < kNumCompBands - 1; i++)
+			split[i].reset(sampleRate);
+		loPhaseComp.reset(sampleRate);
+		hiPhaseComp.reset(sampleRate);
+
+		for (int k = 0; k < kNumCompBands; k++) {
+			lanes.envelope[k] = 0.0f;
+			lanes.gain[k] = 1.0f;
+			lanes.gainStep[k] = 0.0f;
+		}
+		gainCountdown = 0;
+
+		updateLanes();
+		return true;
+	}
+
+	virtual void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		for (int i = 0; i < kNumCompBands - 1; i++)
+			split[i].setSampleRate(sampleRate);
+		loPhaseComp.setSampleRate(sampleRate);
+		hiPhaseComp.setSampleRate(sampleRate);
+		updateLanes();
+	}
+
+	virtual double processAudioSample(double xn) {
+		float band[kNumCompBands];
+		splitBands(xn, band);
+
+		//envelope detectors (mean square), all lanes
+		for (int k = 0; k < kNumCompBands; k++) {
+			float input = band[k] * band[k];
+			float coeff = input > lanes.envelope[k] ? lanes.attackCoeff[k] : lanes.releaseCoeff[k];
+			lanes.envelope[k] = coeff * (lanes.envelope[k] - input) + input;
+		}
+
+		//gain computers at control rate
+		if (--gainCountdown <= 0) {
+			computeGains();
+			gainCountdown = kGainUpdateInterval;
+		}
+
+		//apply gain and sum bands
+		float yn = 0.0f;
+		for (int k = 0; k < kNumCompBands; k++) {
+			lanes.gain[k] += lanes.gainStep[k];
+			yn += band[k] * lanes.gain[k];
+		}
+
+		return yn * makeupGain;
+	}
+
+	virtual bool canProcessAudioFrame() { return false; }
+
+protected:
+	static const int kGainUpdateInterval = 4; //samples
+
+	LB_MultibandCompressorParameters parameters;
+	double sampleRate = 48000;
+
+	LB_LRCrossover split[kNumCompBands - 1];
+	LB_APF loPhaseComp, hiPhaseComp;
+
+	struct Lanes {
+		float envelope[kNumCompBands];     //mean square
+		float attackCoeff[kNumCompBands];
+		float releaseCoeff[kNumCompBands];
+		float threshold_ms[kNumCompBands]; //threshold as mean square
+		float slope[kNumCompBands];        //0.5 * (1/ratio - 1), exponent applied to envelope/threshold
+		float gain[kNumCompBands];
+		float gainStep[kNumCompBands];
+	} lanes;
+
+	float makeupGain = 1.0f;
+	int gainCountdown = 0;
+
+	void splitBands(double xn, float* band) {
+		double lo, hi, b0, b1, b2, b3;
+		split[1].processAudioSample(xn, lo, hi);
+		lo = loPhaseComp.processAudioSample(lo);
+		hi = hiPhaseComp.processAudioSample(hi);
+		split[0].processAudioSample(lo, b0, b1);
+		split[2].processAudioSample(hi, b2, b3);
+		band[0] = (float)b0;
+		band[1] = (float)b1;
+		band[2] = (float)b2;
+		band[3] = (float)b3;
+	}
+
+	void computeGains() {
+		// Same static curve as LB_Compressor::computeGain, worked in the mean square domain:
+		// gr_dB = (1/ratio - 1) * (level_dB - threshold_dB)  ->  gr = (ms / threshold_ms) ^ slope
+		for (int k = 0; k < kNumCompBands; k++) {
+			float over = lanes.envelope[k] / lanes.threshold_ms[k];
+			float target = over > 1.0f ? powf(over, lanes.slope[k]) : 1.0f;
+			lanes.gainStep[k] = (target - lanes.gain[k]) / kGainUpdateInterval;
+		}
+	}
+
+	void updateCrossovers() {
+		for (int i = 0; i < kNumCompBands - 1; i++) {
+			LB_LRCrossoverParameters xoParams = split[i].getParameters();
+			xoParams.fc = parameters.crossoverFreq[i];
+			split[i].setParameters(xoParams);
+		}
+
+		LB_APFParameters apfParams;
+		apfParams.Q = 0.707;
+		apfParams.fc = parameters.crossoverFreq[2];
+		loPhaseComp.setParameters(apfParams);
+		apfParams.fc = parameters.crossoverFreq[0];
+		hiPhaseComp.setParameters(apfParams);
+	}
+
+	void updateLanes() {
+		for (int k = 0; k < kNumCompBands; k++) {
+			lanes.attackCoeff[k] = (float)exp(TLD_AUDIO_ENVELOPE_ANALOG_TC / (parameters.attackTime[k] * sampleRate * 0.001));
+			lanes.releaseCoeff[k] = (float)exp(TLD_AUDIO_ENVELOPE_ANALOG_TC / (parameters.releaseTime[k] * sampleRate * 0.001));
+			lanes.threshold_ms[k] = (float)pow(10.0, parameters.threshold_dB[k] / 10.0);
+			lanes.slope[k] = (float)(0.5 * (1.0 / parameters.ratio[k] - 1.0));
+		}
+		makeupGain = (float)pow(10.0, parameters.outputGain / 20.0);
+	}
+};
+
+/*
+	Sub octave generator, by Lucas Burkholder
+
+	Analog octave pedal style: low pass to get the fundamental, schmitt trigger zero crossing
+	detector toggles a flip flop (so it flips at half the input freq), square wave is scaled by
+	the input envelope and low passed. Output is only the sub, caller mixes it in.
+*/
+
+class LB_SubOctave {
+public:
+	LB_SubOctave() {}
+	~LB_SubOctave() {}
+
+	LB_SubOctaveParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(LB_SubOctaveParameters _parameters) {
+		parameters = _parameters;
+		if (parameters.hysteresis < 0.0) parameters.hysteresis = 0.0;
+
+		LB_LPFParameters lpfParams;
+		lpfParams.Q = 0.707;
+		lpfParams.fc = parameters.inputFc;
+		for (int i = 0; i < 2; i++)
+			inputLPF[i].setParameters(lpfParams);
+		lpfParams.fc = parameters.outputFc;
+		outputLPF.setParameters(lpfParams);
+	}
+
+	bool reset(double _sampleRate) {
+		for (int i = 0; i < 2; i++)
+			inputLPF[i].reset(_sampleRate);
+		outputLPF.reset(_sampleRate);
+
+		envDetector.reset(_sampleRate);
+		LB_EnvDetectorParameters envParams = envDetector.getParameters();
+		envParams.attackTime = 5.0;
+		envParams.releaseTime = 50.0;
+		envParams.detect_dB = false;
+		envDetector.setParameters(envParams);
+
+		triggerHigh = false;
+		flipFlop = false;
+		return true;
+	}
+
+	double processAudioSample(double xn) {
+		double fundamental = inputLPF[1].processAudioSample(inputLPF[0].processAudioSample(xn));
+		double env = envDetector.processAudioSample(fundamental);
+
+		// schmitt trigger, flip flop toggles once per input cycle
+		double threshold = parameters.hysteresis * env;
+		if (!triggerHigh && fundamental > threshold) {
+			triggerHigh = true;
+			flipFlop = !flipFlop;
+		}
+		else if (triggerHigh && fundamental < -threshold) {
+			triggerHigh = false;
+		}
+
+		double square = flipFlop ? env : -env;
+		return outputLPF.processAudioSample(square);
+	}
+
+	void setSampleRate(double _sampleRate) {
+		for (int i = 0; i < 2; i++)
+			inputLPF[i].setSampleRate(_sampleRate);
+		outputLPF.setSampleRate(_sampleRate);
+		envDetector.setSampleRate(_sampleRate);
+	}
+
+	bool canProcessAudioFrame() { return false; }
+
+protected:
+	LB_SubOctaveParameters parameters;
+
+	LB_LPF inputLPF[2];
+	LB_LPF outputLPF;
+	LB_EnvDetector envDetector;
+
+	bool triggerHigh = false;
+	bool flipFlop = false;
+};
+
+/*
+	Sliding window max, by Lucas Burkholder
+	Monotonic deque (in a fixed ring) of values that could still become the max,
+	so push() is O(1) amortized instead of scanning the window
+*/
+
+template <int kMaxWindow>
+class LB_SlidingMax {
+public:
+	LB_SlidingMax() {}
+	~LB_SlidingMax() {}
+
+	void reset(int _windowSize) {
+		windowSize = _windowSize < 1 ? 1 : (_windowSize > kMaxWindow ? kMaxWindow : _windowSize);
+		head = tail = 0;
+		count = 0;
+	}
+
+	// adds a value, returns the max of the last windowSize values
+	double push(double xn) {
+		// drop the front once it has left the window (unsigned, so count can wrap)
+		if (head != tail && count - indices[head] >= (uint32_t)windowSize)
+			head = next(head);
+
+		// drop anything smaller from the back, it can never be the max again
+		while (head != tail && values[prev(tail)] <= xn)
+			tail = prev(tail);
+		values[tail] = xn;
+		indices[tail] = count;
+		tail = next(tail);
+
+		count++;
+		return values[head];
+	}
+
+protected:
+	static const int kSize = kMaxWindow + 1;
+
+	double values[kSize];
+	uint32_t indices[kSize];
+	int head = 0, tail = 0;
+	uint32_t count = 0;
+	int windowSize = 1;
+
+	static int next(int i) { return i + 1 == kSize ? 0 : i + 1; }
+	static int prev(int i) { return i == 0 ? kSize - 1 : i - 1; }
+};
+
+/*
+	Lookahead brickwall limiter, by Lucas Burkholder
+
+	Output is delayed by L = lookahead samples. Per sample gain target is ceiling / max|x| over the
+	last L + 1 samples (sliding max), then smoothed with an L long moving average. Every target
+	in that average covers the sample leaving the delay line, so the averaged gain is never more than
+	that sample needs -> no overs, and the gain ramps down over L samples instead of jumping.
+	Release is a one pole on top (only when the gain goes back up).
+*/
+
+class LB_Limiter {
+public:
+	LB_Limiter() {}
+	~LB_Limiter() {}
+
+	LB_LimiterParameters getParameters() {
+		return parameters;
+	}
+
+	void setParameters(LB_LimiterParameters _parameters) {
+		bool lookaheadChanged = parameters.lookahead != _parameters.lookahead;
+		parameters = _parameters;
+
+		if (parameters.lookahead < 1) parameters.lookahead = 1;
+		if (parameters.lookahead > kMaxLookahead) parameters.lookahead = kMaxLookahead;
+
+		ceiling = pow(10.0, parameters.ceiling_dB / 20.0);
+		releaseCoeff = exp(TLD_AUDIO_ENVELOPE_ANALOG_TC / (parameters.releaseTime * sampleRate * 0.001));
+
+		if (lookaheadChanged) clearState();
+	}
+
+	bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		setParameters(parameters);
+		clearState();
+		return true;
+	}
+
+	double processAudioSample(double xn) {
+		int L = parameters.lookahead;
+
+		// gain target from the peak over the last L + 1 samples
+		double peak = peakDetector.push(fabs(xn));
+		double target = peak > ceiling ? ceiling / peak : 1.0;
+
+		// L long moving average of the targets. Re-summed once per lap so rounding in the
+		// running sum can't drift
+		gainSum += target - gainHistory[gainPos];
+		gainHistory[gainPos] = target;
+		if (++gainPos >= L) {
+			gainPos = 0;
+			gainSum = 0.0;
+			for (int i = 0; i < L; i++)
+				gainSum += gainHistory[i];
+		}
+		double smoothed = gainSum * invLookahead;
+
+		// release only slows the gain coming back up
+		if (smoothed < gain) gain = smoothed;
+		else gain = releaseCoeff * (gain - smoothed) + smoothed;
+
+		// delay line
+		double delayed = delayLine[delayPos];
+		delayLine[delayPos] = xn;
+		if (++delayPos >= L) delayPos = 0;
+
+		return delayed * gain;
+	}
+
+	void setSampleRate(double _sampleRate) {
+		sampleRate = _sampleRate;
+		setParameters(parameters);
+	}
+
+	bool canProcessAudioFrame() { return false; }
+
+	int getLatency() { return parameters.lookahead; }
+
+protected:
+	LB_LimiterParameters parameters;
+	double sampleRate = 48000;
+
+	double ceiling = 1.0;
+	double releaseCoeff = 0.0;
+
+	LB_SlidingMax<kMaxLookahead + 1> peakDetector;
+
+	double delayLine[kMaxLookahead];
+	int delayPos = 0;
+
+	double gainHistory[kMaxLookahead];
+	int gainPos = 0;
+	double gainSum = 0.0;
+	double invLookahead = 1.0;
+	double gain = 1.0;
+
+	void clearState() {
+		int L = parameters.lookahead;
+		peakDetector.reset(L + 1);
+		memset(&delayLine[0], 0, sizeof(double) * kMaxLookahead);
+		for (int i = 0; i < kMaxLookahead; i++)
+			gainHistory[i] = 1.0;
+		gainSum = L;
+		invLookahead = 1.0 / L;
+		delayPos = gainPos = 0;
+		gain = 1.0;
+	}
+};
+
+/*
+	Coefficient table, by Lucas Burkholder
+
+	Precomputes a filter's coefficients over a grid of frequency (log spaced) x gain (linear),
+	built once per sample rate in the main loop. lookup() takes 0-1 positions along each axis
+	(e.g. straight from a knob) and bilinearly interpolates, so no pow/tan/cos in the callback.
+	The 2nd order stability region is convex in (b1, b2), so interpolating between stable
+	neighbours is always stable. Either axis can have a single point.
+	Filter needs reset/setParameters/getCoefficients, FilterParameters needs fc and gain.
+*/
+
+template <class Filter, class FilterParameters, int kNumFreqs, int kNumGains>
+class LB_CoeffTable {
+public:
+	LB_CoeffTable() {}
+	~LB_CoeffTable() {}
+
+	// main loop only. baseParams supplies everything except fc/gain (e.g. Q)
+	void build(double _sampleRate, FilterParameters baseParams, double fMin, double fMax, double gMin, double gMax) {
+		Filter designer;
+		designer.reset(_sampleRate);
+
+		for (int i = 0; i < kNumFreqs; i++) {
+			for (int j = 0; j < kNumGains; j++) {
+				FilterParameters params = baseParams;
+				params.fc = kNumFreqs > 1 ? fMin * pow(fMax / fMin, (double)i / (kNumFreqs - 1)) : fMin;
+				params.gain = kNumGains > 1 ? gMin + (gMax - gMin) * j / (kNumGains - 1) : gMin;
+				designer.setParameters(params);
+				memcpy(&table[i][j][0], designer.getCoefficients(), sizeof(double) * numCoeffs);
+			}
+		}
+	}
+
+	void lookup(double freqPos, double gainPos, double* coeffs) {
+		int fi, gi;
+		double fFrac, gFrac;
+		locate(freqPos, kNumFreqs, fi, fFrac);
+		locate(gainPos, kNumGains, gi, gFrac);
+		int fi1 = kNumFreqs > 1 ? fi + 1 : fi;
+		int gi1 = kNumGains > 1 ? gi + 1 : gi;
+
+		for (int c = 0; c < numCoeffs; c++) {
+			double lo = table[fi][gi][c] + gFrac * (table[fi][gi1][c] - table[fi][gi][c]);
+			double hi = table[fi1][gi][c] + gFrac * (table[fi1][gi1][c] - table[fi1][gi][c]);
+			coeffs[c] = lo + fFrac * (hi - lo);
+		}
+	}
+
+protected:
+	double table[kNumFreqs][kNumGains][numCoeffs];
+
+	static void locate(double pos, int numPoints, int& index, double& frac) {
+		if (numPoints < 2) {
+			index = 0;
+			frac = 0.0;
+			return;
+		}
+		pos *= numPoints - 1;
+		if (pos < 0.0) pos = 0.0;
+		if (pos > numPoints - 1) pos = numPoints - 1;
+		index = (int)pos;
+		if (index > numPoints - 2) index = numPoints - 2;
+		frac = pos - index;
+	}
+};
+
+/*
+	YIN pitch detector, by Lucas Burkholder
+
+	Meant to run on a decimated signal in the main loop, not the callback. startAnalysis() copies in
+	one frame, then processChunk() computes the cumulative mean normalized difference a few lags at
+	a time so one estimate can be spread over many main loop passes.
+	Stops early at the first dip under the threshold, so high notes finish in fewer lags.
+*/
+
+const int kYinWindow = 256;
+const int kYinMaxLag = 256;
+const int kYinFrameSize = kYinWindow + kYinMaxLag;
+
+class LB_PitchDetector {
+public:
+	LB_PitchDetector() {}
+	~LB_PitchDetector() {}
+
+	bool reset(double _sampleRate) {
+		sampleRate = _sampleRate;
+		busy = false;
+		frequency = 0.0;
+		clarity = 0.0;
+		return true;
+	}
+
+	void startAnalysis(const float* _frame) {
+		memcpy(&frame[0], &_frame[0], sizeof(float) * kYinFrameSize);
+		cmnd[0] = 1.0f;
+		runningSum = 0.0f;
+		nextLag = 1;
+		busy = true;
+	}
+
+	// returns true when this call finished an estimate
+	bool processChunk(int maxLags) {
+		if (!busy) return false;
+
+		int lastLag = nextLag + maxLags;
+		if (lastLag > kYinMaxLag) lastLag = kYinMaxLag;
+
+		for (; nextLag < lastLag; nextLag++) {
+			int tau = nextLag;
+			float d = 0.0f;
+			for (int j = 0; j < kYinWindow; j++) {
+				float diff = frame[j] - frame[j + tau];
+				d += diff * diff;
+			}
+			runningSum += d;
+			cmnd[tau] = runningSum > 0.0f ? d * tau / runningSum : 1.0f;
+
+			//first dip under threshold has bottomed out, done
+			if (tau > kMinLag + 1 && cmnd[tau - 1] < kThreshold && cmnd[tau] >= cmnd[tau - 1]) {
+				nextLag = tau + 1;
+				finishEstimate(tau - 1);
+				return true;
+			}
+		}
+
+		if (nextLag >= kYinMaxLag) {
+			//no dip under threshold, take the global min and let clarity say how good it is
+			int best = kMinLag;
+			for (int tau = kMinLag; tau < kYinMaxLag; tau++)
+				if (cmnd[tau] < cmnd[best]) best = tau;
+			finishEstimate(best);
+			return true;
+		}
+		return false;
+	}
+
+	bool isBusy() { return busy; }
+
+	// drops an estimate in progress, the next startAnalysis() begins fresh
+	void cancel() { busy = false; }
+
+	double getFrequency() { return frequency; } // Hz, 0 if no estimate
+
+	double getClarity() { return clarity; } // 0-1, 1 = perfectly periodic
+
+protected:
+	static const int kMinLag = 2;
+	static constexpr float kThreshold = 0.15f;
+
+	double sampleRate = 6000;
+	float frame[kYinFrameSize];
+	float cmnd[kYinMaxLag]; //cumulative mean normalized difference
+	float runningSum = 0.0f;
+	int nextLag = 1;
+	bool busy = false;
+
+	double frequency = 0.0;
+	double clarity = 0.0;
+
+	void finishEstimate(int tau) {
+		busy = false;
+		clarity = 1.0 - cmnd[tau];
+
+		//parabolic interpolation around the min
+		double period = tau;
+		if (tau > 1 && tau + 1 < nextLag) {
+			double prev = cmnd[tau - 1], curr = cmnd[tau], next = cmnd[tau + 1];
+			double den = prev - 2.0 * curr + next;
+			if (den > 0.0) period += 0.5 * (prev - next) / den;
+		}
+		frequency = sampleRate / period;
+	}
+};
 
 /**
 TanH wave shaper
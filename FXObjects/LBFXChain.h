@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include "LBFX.h"
+
+const int kMaxChainLength = 8;
+
+/*
+Fixed arena allocator for FX objects, by Lucas Burkholder
+Bump allocates out of a static pool with placement new, never touches the heap.
+Objects are never freed - each FX type is created once and reused by every chain that needs it
+*/
+
+template <size_t kArenaBytes>
+class LB_FXArena {
+public:
+	LB_FXArena() {}
+	~LB_FXArena() {}
+
+	// returns nullptr if the arena is full
+	template <class T>
+	T* create() {
+		size_t start = (bytesUsed + alignof(T) - 1) & ~(alignof(T) - 1);
+		if (start + sizeof(T) > kArenaBytes) return nullptr;
+		bytesUsed = start + sizeof(T);
+		return new (&pool[start]) T();
+	}
+
+	size_t getBytesUsed() { return bytesUsed; }
+
+	size_t getBytesFree() { return kArenaBytes - bytesUsed; }
+
+private:
+	alignas(max_align_t) uint8_t pool[kArenaBytes];
+	size_t bytesUsed = 0;
+};
+
+/*
+Effect chain, by Lucas Burkholder
+Ordered list of FX objects, processed serially
+*/
+
+struct LB_FXChain {
+	LB_FXChain() {}
+
+	bool append(IAudioSignalProcessor* fx) {
+		if (fx == nullptr || length >= kMaxChainLength) return false;
+		chain[length++] = fx;
+		return true;
+	}
+
+	void clear() { length = 0; }
+
+	double processAudioSample(double xn) {
+		for (int i = 0; i < length; i++)
+			xn = chain[i]->processAudioSample(xn);
+		return xn;
+	}
+
+	IAudioSignalProcessor* chain[kMaxChainLength] = { nullptr };
+	int length = 0;
+};
+
+/*
+Double buffered chain switcher, by Lucas Burkholder
+
+The main loop edits the inactive chain (beginEdit) then hands it to the audio thread with one
+atomic pointer exchange (commit). The audio callback preempts the main loop and never the other
+way around, so once commit() returns no callback is still using the old chain and it is free
+to be edited next time.
+*/
+
+class LB_FXChainSwitcher {
+public:
+	LB_FXChainSwitcher() : active(&chains[0]) {}
+	~LB_FXChainSwitcher() {}
+
+	// main loop only. Returns the inactive chain, cleared
+	LB_FXChain* beginEdit() {
+		LB_FXChain* next = (active.load(std::memory_order_relaxed) == &chains[0]) ? &chains[1] : &chains[0];
+		next->clear();
+		return next;
+	}
+
+	// main loop only
+	void commit(LB_FXChain* next) {
+		active.exchange(next, std::memory_order_acq_rel);
+	}
+
+	// audio thread. Read once per callback
+	LB_FXChain* getActive() {
+		return active.load(std::memory_order_acquire);
+	}
+
+private:
+	LB_FXChain chains[2];
+	std::atomic<LB_FXChain*> active;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+Per block execution time profiler, by Lucas Burkholder
+
+Records the cost of each audio block (cycles, or any tick) into a histogram per mode combination,
+so the worst case and high percentiles can be read back per mode, not just the average.
+record() runs in the callback and is O(1). Histogram buckets are linear from 0 to 2x budget,
+anything above lands in the last bucket (max is still exact).
+*/
+
+template <int kNumModes, int kNumBuckets = 64>
+class LB_BlockProfiler {
+public:
+	LB_BlockProfiler() {}
+	~LB_BlockProfiler() {}
+
+	void reset(uint32_t _budget) {
+		budget = _budget > 0 ? _budget : 1;
+		bucketWidth = (2 * budget) / kNumBuckets;
+		if (bucketWidth == 0) bucketWidth = 1;
+		memset(&histogram[0][0], 0, sizeof(histogram));
+		memset(&count[0], 0, sizeof(count));
+		memset(&maxCost[0], 0, sizeof(maxCost));
+		memset(&overruns[0], 0, sizeof(overruns));
+	}
+
+	// audio thread, once per block
+	void record(int mode, uint32_t cost) {
+		if (mode < 0 || mode >= kNumModes) return;
+
+		uint32_t bucket = cost / bucketWidth;
+		if (bucket >= (uint32_t)kNumBuckets) bucket = kNumBuckets - 1;
+		histogram[mode][bucket]++;
+		count[mode]++;
+		if (cost > maxCost[mode]) maxCost[mode] = cost;
+		if (cost > budget) overruns[mode]++;
+	}
+
+	uint32_t getBudget() { return budget; }
+
+	uint32_t getCount(int mode) { return count[mode]; }
+
+	uint32_t getMax(int mode) { return maxCost[mode]; } // observed WCET
+
+	uint32_t getOverruns(int mode) { return overruns[mode]; }
+
+	// upper edge of the bucket holding the given percentile (0-100)
+	uint32_t getPercentile(int mode, float percentile) {
+		if (count[mode] == 0) return 0;
+		uint32_t target = (uint32_t)(count[mode] * percentile / 100.0f);
+		uint32_t sum = 0;
+		for (int b = 0; b < kNumBuckets; b++) {
+			sum += histogram[mode][b];
+			if (sum > target) return (b + 1) * bucketWidth;
+		}
+		return maxCost[mode];
+	}
+
+private:
+	uint32_t histogram[kNumModes][kNumBuckets];
+	uint32_t count[kNumModes];
+	uint32_t maxCost[kNumModes];
+	uint32_t overruns[kNumModes];
+	uint32_t budget = 1;
+	uint32_t bucketWidth = 1;
+};
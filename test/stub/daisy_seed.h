@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in for libDaisy, just enough for BassPedalFunctions.h and the FX headers
+
+namespace daisy {
+struct Color {
+    void Init(float _r, float _g, float _b) { r = _r; g = _g; b = _b; }
+    float r = 0.0f, g = 0.0f, b = 0.0f;
+};
+}
@@ -0,0 +1,70 @@
+#include "test_common.h"
+#include <initializer_list>
+
+// AutoGain trim: centre of the gain knob is exactly the calibrated gain, the ends are +-trimRange_dB
+// around it, the trim never leaves that range and never goes backwards as the knob turns up
+
+const double kSampleRate = 48000.0;
+const int kBlockSize = 4;
+
+static void setupAutoGain(AutoGain& autoGain) {
+    autoGain.reset(kSampleRate);
+    AutoGainParameters params = autoGain.getParameters();
+    params.blockSize = kBlockSize;
+    autoGain.setParameters(params);
+}
+
+// block gain after the smoothing has settled
+static double settledGain(AutoGain& autoGain, double knob) {
+    double gain = 0.0;
+    for (int b = 0; b < 48000 / kBlockSize; b++) gain = autoGain.getBlockGain(knob);
+    return gain;
+}
+
+static void testTrimAroundCalibration() {
+    for (double calibrated : { 0.05, 1.0, 2.5, 40.0 }) {
+        AutoGain autoGain;
+        setupAutoGain(autoGain);
+        autoGain.setCalibratedGain(calibrated);
+        AutoGainParameters params = autoGain.getParameters();
+
+        for (double knob : { 0.45 + 1e-6, 0.5, 0.55 - 1e-6 }) {
+            double gain = settledGain(autoGain, knob);
+            CHECK(fabs(gain / calibrated - 1.0) < 1e-9, "calibrated %g: knob %.6f gives %.6f, not the calibrated gain",
+                  calibrated, knob, gain);
+        }
+
+        double low_dB = 20.0 * log10(settledGain(autoGain, 0.0) / calibrated);
+        double high_dB = 20.0 * log10(settledGain(autoGain, 1.0) / calibrated);
+        CHECK(fabs(low_dB + params.trimRange_dB) < 1e-6, "calibrated %g: knob 0 trims %.3f dB", calibrated, low_dB);
+        CHECK(fabs(high_dB - params.trimRange_dB) < 1e-6, "calibrated %g: knob 1 trims %.3f dB", calibrated, high_dB);
+    }
+}
+
+static void testTrimMonotonic() {
+    AutoGain autoGain;
+    setupAutoGain(autoGain);
+    AutoGainParameters params = autoGain.getParameters();
+
+    double prev_dB = -1000.0;
+    int backwards = 0;
+    double worstOutside = 0.0;
+    for (int i = 0; i <= 1000; i++) {
+        double trim_dB = 20.0 * log10(autoGain.getTrimGain(i / 1000.0));
+        if (trim_dB < prev_dB - 1e-12) backwards++;
+        worstOutside = fmax(worstOutside, fabs(trim_dB) - params.trimRange_dB);
+        prev_dB = trim_dB;
+    }
+    CHECK(backwards == 0, "trim went down %d times as the knob turned up", backwards);
+    CHECK(worstOutside < 1e-9, "trim left the +-%.0f dB range by %g dB", params.trimRange_dB, worstOutside);
+
+    // out of range ADC readings stay clamped
+    CHECK(fabs(autoGain.getTrimGain(-0.1) - autoGain.getTrimGain(0.0)) < 1e-12, "knob below 0 not clamped");
+    CHECK(fabs(autoGain.getTrimGain(1.1) - autoGain.getTrimGain(1.0)) < 1e-12, "knob above 1 not clamped");
+}
+
+int main() {
+    testTrimAroundCalibration();
+    testTrimMonotonic();
+    return testResult("test_autogain");
+}
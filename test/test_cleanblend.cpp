@@ -0,0 +1,86 @@
+#include "test_common.h"
+
+// CleanBlend: swapping in the clean low end never notches the response around the split, for every
+// fat/punch/melody combination and mix setting. The dry lane has to follow the wet chain's phase
+
+const double kSampleRate = 48000.0;
+
+struct Pedal {
+    FatPunch fatPunch;
+    MelodyMode melodyMode;
+    CleanBlend cleanBlend;
+    bool matchPhase = true;
+
+    void setup(bool fat, bool punch, bool melody, double mix) {
+        fatPunch.reset(kSampleRate);
+        melodyMode.reset(kSampleRate);
+        cleanBlend.reset(kSampleRate);
+
+        FatPunchParameters fpParams;
+        fpParams.fatOn = fat;
+        fpParams.darkenOn = false;
+        fpParams.punchCompOn = punch;
+        fpParams.subLevel = 0.0;
+        fatPunch.setParameters(fpParams);
+
+        MelodyModeParameters mmParams;
+        mmParams.on = melody;
+        melodyMode.setParameters(mmParams);
+
+        // as the callback does
+        CleanBlendParameters cbParams = cleanBlend.getParameters();
+        cbParams.mix = mix;
+        cbParams.numDryPhaseStages = matchPhase ? fatPunch.getPhaseStages(cbParams.dryPhaseFreq) : 0;
+        cleanBlend.setParameters(cbParams);
+    }
+
+    double processAudioSample(double xn) {
+        double wet = melodyMode.processAudioSample(fatPunch.processAudioSample(xn));
+        return cleanBlend.processAudioSample(xn, wet);
+    }
+};
+
+const int kNumFreqs = 20;
+
+static double freqAt(int i) { return 30.0 * pow(400.0 / 30.0, (double)i / (kNumFreqs - 1)); }
+
+static double response(Pedal& pedal, bool fat, bool punch, bool melody, double mix, double f) {
+    // small signal keeps the waveshapers linear and the compressor under threshold
+    pedal.setup(fat, punch, melody, mix);
+    return sineGain_dB([&](double x) { return pedal.processAudioSample(x); }, f, kSampleRate, 1e-4);
+}
+
+int main() {
+    static Pedal pedal;
+    const double mixes[] = { 0.5, 1.0 };
+    for (int combo = 0; combo < 8; combo++) {
+        bool fat = combo & 1, punch = combo & 2, melody = combo & 4;
+
+        double wet[kNumFreqs];
+        pedal.matchPhase = true;
+        for (int i = 0; i < kNumFreqs; i++) wet[i] = response(pedal, fat, punch, melody, 0.0, freqAt(i));
+
+        for (double mix : mixes) {
+            // worst dip against the lower of the all wet response and the clean (0dB) low end.
+            // Without the dry phase match for reference
+            double dip = 0.0, unmatchedDip = 0.0, worstFreq = 0.0;
+            for (int i = 0; i < kNumFreqs; i++) {
+                double floor = wet[i] < 0.0 ? wet[i] : 0.0;
+                pedal.matchPhase = true;
+                double d = floor - response(pedal, fat, punch, melody, mix, freqAt(i));
+                if (d > dip) {
+                    dip = d;
+                    worstFreq = freqAt(i);
+                }
+                pedal.matchPhase = false;
+                d = floor - response(pedal, fat, punch, melody, mix, freqAt(i));
+                if (d > unmatchedDip) unmatchedDip = d;
+            }
+            printf("fat %d punch %d melody %d mix %.1f: worst dip %.2f dB (%.2f dB without phase match)\n",
+                   fat, punch, melody, mix, dip, unmatchedDip);
+            CHECK(dip < 1.0, "fat %d punch %d melody %d mix %.1f: %.2f dB dip at %.0f Hz",
+                  fat, punch, melody, mix, dip, worstFreq);
+        }
+    }
+    return testResult("test_cleanblend");
+}
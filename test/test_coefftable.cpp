@@ -0,0 +1,72 @@
+#include "test_common.h"
+
+// LB_CoeffTable: worst response error of every tone table against an exact design at the same
+// knob position, over the whole audio band
+
+// the tables are protected, reach them through the real objects
+struct FatPunchTables : FatPunch {
+    using FatPunch::lpeqTable;
+    using FatPunch::hsfTable;
+};
+struct MelodyModeTables : MelodyMode {
+    using MelodyMode::midEQTable;
+};
+
+// max |dB| difference between the table at knob position pos and Filter designed exactly there
+template <class Filter, class FilterParameters, class Table>
+double worstError_dB(Table& table, double sampleRate, FilterParameters baseParams,
+                     double fMin, double fMax, double gMin, double gMax, bool sweepFreq) {
+    Filter exact;
+    exact.reset(sampleRate);
+    double worst = 0.0;
+    for (int k = 0; k <= 1000; k++) {
+        double pos = k / 1000.0;
+        double tableCoeffs[numCoeffs];
+        table.lookup(sweepFreq ? pos : 0.0, sweepFreq ? 0.0 : pos, tableCoeffs);
+
+        FilterParameters params = baseParams;
+        params.fc = sweepFreq ? fMin * pow(fMax / fMin, pos) : fMin;
+        params.gain = sweepFreq ? gMin : gMin + (gMax - gMin) * pos;
+        exact.setParameters(params);
+        const double* exactCoeffs = exact.getCoefficients();
+
+        for (int i = 0; i <= 200; i++) {
+            double f = 20.0 * pow(1000.0, i / 200.0); //20Hz-20kHz
+            double err = fabs(coeffMag_dB(tableCoeffs, f, sampleRate) - coeffMag_dB(exactCoeffs, f, sampleRate));
+            if (err > worst) worst = err;
+        }
+    }
+    return worst;
+}
+
+int main() {
+    const double rates[] = { 32000.0, 48000.0, 96000.0 };
+    for (double sampleRate : rates) {
+        static FatPunchTables fatPunch;
+        static MelodyModeTables melodyMode;
+        fatPunch.reset(sampleRate);
+        melodyMode.reset(sampleRate);
+
+        // ranges and base parameters as in FatPunch/MelodyMode::buildToneTables
+        LB_PEQParameters fatParams;
+        fatParams.gain = 8.0;
+        fatParams.Q = 0.4;
+        double fatErr = worstError_dB<LB_PEQ>(fatPunch.lpeqTable, sampleRate, fatParams, 50.0, 200.0, 8.0, 8.0, true);
+
+        LB_HSFParameters darkParams;
+        darkParams.fc = 700.0;
+        double darkErr = worstError_dB<LB_HSF>(fatPunch.hsfTable, sampleRate, darkParams, 700.0, 700.0, 0.0, -28.0, false);
+
+        LB_PEQParameters midParams;
+        midParams.gain = 10.0;
+        midParams.Q = 0.3;
+        double midErr = worstError_dB<LB_PEQ>(melodyMode.midEQTable, sampleRate, midParams, 559.0, 2236.0, 10.0, 10.0, true);
+
+        printf("%5.0f Hz: fat EQ %.4f dB, darken shelf %.4f dB, melody mid %.4f dB worst error\n",
+               sampleRate, fatErr, darkErr, midErr);
+        CHECK(fatErr < 0.005, "fat EQ table error %.4f dB", fatErr);
+        CHECK(darkErr < 0.005, "darken shelf table error %.4f dB", darkErr);
+        CHECK(midErr < 0.005, "melody mid table error %.4f dB", midErr);
+    }
+    return testResult("test_coefftable");
+}
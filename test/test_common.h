@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../FXObjects/LBFX.h"
+#include "../FXObjects/LBFX.cpp"
+#include "../FXObjects/BassPedalFX.h"
+
+/*
+Tiny host test helpers, by Lucas Burkholder
+CHECK prints and counts failures, main returns testResult() so make check stops on the first failing test
+*/
+
+static int testFailures = 0;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        testFailures++; \
+    } \
+} while (0)
+
+inline int testResult(const char* name) {
+    printf("%s: %s\n", name, testFailures == 0 ? "PASS" : "FAIL");
+    return testFailures == 0 ? 0 : 1;
+}
+
+inline double nowNs() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// deterministic white noise in -1..1 (same on every host)
+struct TestNoise {
+    uint32_t state = 22222;
+    double next() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) * (2.0 / 16777216.0) - 1.0;
+    }
+};
+
+// steady state gain in dB of process() for a sine at freq, RMS out / RMS in
+template <class Process>
+double sineGain_dB(Process process, double freq, double sampleRate, double amplitude = 0.01) {
+    int settle = (int)(sampleRate * 0.5);
+    int measure = (int)(sampleRate * 0.5);
+    double sumIn = 0.0, sumOut = 0.0;
+    for (int n = 0; n < settle + measure; n++) {
+        double x = amplitude * sin(2.0 * kPi * freq * n / sampleRate);
+        double y = process(x);
+        if (n >= settle) {
+            sumIn += x * x;
+            sumOut += y * y;
+        }
+    }
+    return 10.0 * log10(sumOut / sumIn);
+}
+
+// magnitude in dB of a biquad coefficient set (LB_PEQ/LB_HSF form: d0 + c0 * H) at freq
+inline double coeffMag_dB(const double* c, double freq, double sampleRate) {
+    double w = 2.0 * kPi * freq / sampleRate;
+    double cr1 = cos(w), ci1 = -sin(w), cr2 = cos(2 * w), ci2 = -sin(2 * w);
+    double numR = c[a0] + c[a1] * cr1 + c[a2] * cr2, numI = c[a1] * ci1 + c[a2] * ci2;
+    double denR = 1.0 + c[b1] * cr1 + c[b2] * cr2, denI = c[b1] * ci1 + c[b2] * ci2;
+    double den = denR * denR + denI * denI;
+    double hR = (numR * denR + numI * denI) / den, hI = (numI * denR - numR * denI) / den;
+    double yR = c[d0] + c[c0] * hR, yI = c[c0] * hI;
+    return 10.0 * log10(yR * yR + yI * yI);
+}
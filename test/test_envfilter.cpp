@@ -0,0 +1,61 @@
+#include "test_common.h"
+#include <initializer_list>
+
+// LB_SVF pass bands are unity for every Q (band-pass peak included), and EnvelopeFilter never
+// boosts what it passes, so MelodyMode's waveshaper after it sees the same level whatever the Q
+
+const double kSampleRate = 48000.0;
+
+static void testSVFUnity() {
+    double worstPeak = 0.0, worstPass = 0.0;
+    for (double Q : { 0.5, 0.707, 2.0, 4.0, 8.0 }) {
+        for (double fc : { 80.0, 400.0, 2000.0 }) {
+            LB_SVF svf;
+            svf.reset(kSampleRate);
+            LB_SVFParameters params;
+            params.fc = fc;
+            params.Q = Q;
+
+            params.mode = svfBandPass;
+            svf.setParameters(params);
+            double peak = sineGain_dB([&](double x) { return svf.processAudioSample(x); }, fc, kSampleRate);
+            CHECK(fabs(peak) < 0.1, "band-pass fc %g Q %g: %.2f dB at fc", fc, Q, peak);
+            worstPeak = fmax(worstPeak, fabs(peak));
+
+            // well inside the pass band of the low and high pass
+            params.mode = svfLowPass;
+            svf.reset(kSampleRate);
+            svf.setParameters(params);
+            double lp = sineGain_dB([&](double x) { return svf.processAudioSample(x); }, fc / 20.0, kSampleRate);
+            params.mode = svfHighPass;
+            svf.reset(kSampleRate);
+            svf.setParameters(params);
+            double hp = sineGain_dB([&](double x) { return svf.processAudioSample(x); }, fmin(fc * 8.0, 18000.0), kSampleRate);
+            CHECK(fabs(lp) < 0.1 && fabs(hp) < 0.3, "fc %g Q %g: low pass %.2f dB, high pass %.2f dB", fc, Q, lp, hp);
+            worstPass = fmax(worstPass, fmax(fabs(lp), fabs(hp)));
+        }
+    }
+    printf("SVF: band-pass peak within %.3f dB, low/high pass bands within %.3f dB of unity\n", worstPeak, worstPass);
+}
+
+static void testEnvelopeFilterLevel() {
+    // loud and quiet sines over the bass range and the whole sweep, default Q 4
+    double worst = -100.0;
+    for (double amplitude : { 0.003, 0.03, 0.3 }) {
+        for (int i = 0; i < 40; i++) {
+            double freq = 30.0 * pow(4000.0 / 30.0, i / 39.0);
+            static EnvelopeFilter envFilter;
+            envFilter.reset(kSampleRate);
+            double gain = sineGain_dB([&](double x) { return envFilter.processAudioSample(x); }, freq, kSampleRate, amplitude);
+            worst = fmax(worst, gain);
+        }
+    }
+    CHECK(worst < 0.5, "envelope filter boosts by %.2f dB", worst);
+    printf("envelope filter: most gain %.2f dB\n", worst);
+}
+
+int main() {
+    testSVFUnity();
+    testEnvelopeFilterLevel();
+    return testResult("test_envfilter");
+}
@@ -0,0 +1,140 @@
+#include "test_common.h"
+#include "../FXObjects/BassPedalPresets.h"
+#include <algorithm>
+#include <new>
+
+// Preset fuzzing through the firmware's loadPreset/getFX: no heap allocation, bounded switch time,
+// a failed load never touches the active chain and drops the request instead of retrying forever
+
+static volatile bool trackAllocations = false;
+static int allocationCount = 0;
+
+void* operator new(size_t size) {
+    if (trackAllocations) allocationCount++;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    if (trackAllocations) allocationCount++;
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+const double kSampleRate = 48000.0;
+const int kIterations = 20000;
+
+static bool chainIsPreset(LB_FXChain* chain, int presetNum, IAudioSignalProcessor* (&instances)[numFX]) {
+    if (chain->length != presets[presetNum].length) return false;
+    for (int i = 0; i < chain->length; i++)
+        if (chain->chain[i] != instances[presets[presetNum].order[i]]) return false;
+    return true;
+}
+
+// random requests, valid and not, applied the way the main loop does, with audio blocks in between
+static void testFuzz() {
+    static LB_FXArena<kFXArenaBytes> arena;
+    static IAudioSignalProcessor* instances[numFX] = { nullptr };
+    static LB_FXChainSwitcher fxChain;
+    int activePreset = -1;
+    volatile int requestedPreset = 0;
+    TestNoise rng;
+
+    trackAllocations = true;
+
+    // boot, as main() does
+    getFX(fxFatPunch, arena, instances, kSampleRate);
+    getFX(fxMelodyMode, arena, instances, kSampleRate);
+    loadPreset(requestedPreset, arena, instances, fxChain, kSampleRate, activePreset, requestedPreset);
+    CHECK(activePreset == 0 && chainIsPreset(fxChain.getActive(), 0, instances), "boot preset not loaded");
+
+    static double loadTimes[kIterations];
+    int numTimed = 0, loads = 0, rejected = 0;
+    double sink = 0.0;
+    for (int iteration = 0; iteration < kIterations; iteration++) {
+        // UI side: next preset mostly, sometimes garbage
+        requestedPreset = (int)((rng.next() * 0.5 + 0.5) * (numPresets + 4)) - 2;
+
+        // main loop side
+        if (requestedPreset != activePreset) {
+            int requested = requestedPreset, before = activePreset;
+            LB_FXChain* beforeChain = fxChain.getActive();
+            size_t arenaBefore = arena.getBytesUsed();
+
+            double start = nowNs();
+            bool ok = loadPreset(requestedPreset, arena, instances, fxChain, kSampleRate, activePreset, requestedPreset);
+            double ns = nowNs() - start;
+            if (arena.getBytesUsed() == arenaBefore) loadTimes[numTimed++] = ns; //creating an effect is boot-like work
+
+            if (ok) {
+                loads++;
+                CHECK(activePreset == requested && chainIsPreset(fxChain.getActive(), requested, instances),
+                      "preset %d loaded the wrong chain", requested);
+            } else {
+                rejected++;
+                CHECK(activePreset == before && fxChain.getActive() == beforeChain, "failed load of %d changed the active chain", requested);
+                CHECK(requestedPreset == activePreset, "failed load of %d left the request pending", requested);
+            }
+        }
+
+        // one audio block
+        LB_FXChain* chain = fxChain.getActive();
+        for (int n = 0; n < 4; n++) sink += chain->processAudioSample(0.3 * rng.next());
+    }
+
+    trackAllocations = false;
+
+    std::sort(loadTimes, loadTimes + numTimed);
+    double p999 = loadTimes[(int)(numTimed * 0.999)];
+    printf("arena: %d bytes used, %d free\n", (int)arena.getBytesUsed(), (int)arena.getBytesFree());
+    printf("%d loads, %d rejected, loadPreset p50 %.0f ns, p99.9 %.0f ns, max %.0f ns\n",
+           loads, rejected, loadTimes[numTimed / 2], p999, loadTimes[numTimed - 1]);
+    CHECK(allocationCount == 0, "%d heap allocations during preset changes", allocationCount);
+    CHECK(p999 < 2000.0, "loadPreset p99.9 %.0f ns", p999);
+    CHECK(loadTimes[numTimed - 1] < 1000000.0, "loadPreset max %.0f ns", loadTimes[numTimed - 1]);
+    CHECK(std::isfinite(sink), "chain output not finite");
+}
+
+// arena with no room for the envelope filter: the auto-wah preset must fail cleanly
+static void testArenaFull() {
+    static LB_FXArena<sizeof(FatPunch) + sizeof(MelodyMode) + 16> arena;
+    static IAudioSignalProcessor* instances[numFX] = { nullptr };
+    static LB_FXChainSwitcher fxChain;
+    int activePreset = -1;
+    volatile int requestedPreset = 0;
+
+    CHECK(loadPreset(requestedPreset, arena, instances, fxChain, kSampleRate, activePreset, requestedPreset),
+          "default preset should fit");
+
+    requestedPreset = 2;
+    LB_FXChain* before = fxChain.getActive();
+    bool ok = loadPreset(requestedPreset, arena, instances, fxChain, kSampleRate, activePreset, requestedPreset);
+    CHECK(!ok, "auto-wah loaded without room for the envelope filter");
+    CHECK(fxChain.getActive() == before && chainIsPreset(before, 0, instances), "failed load changed the active chain");
+    CHECK(requestedPreset == 0 && activePreset == 0, "request %d / active %d after failure, main loop would retry",
+          requestedPreset, activePreset);
+    CHECK(instances[fxEnvFilter] == nullptr, "envelope filter instance set without an allocation");
+
+    // nothing fits at boot: no chain, and no retry either
+    struct Filler { uint8_t bytes[kFXArenaBytes - 64]; };
+    static LB_FXArena<kFXArenaBytes> emptyArena;
+    emptyArena.create<Filler>();
+    static IAudioSignalProcessor* emptyInstances[numFX] = { nullptr };
+    static LB_FXChainSwitcher emptyChain;
+    activePreset = -1;
+    requestedPreset = 0;
+    ok = loadPreset(requestedPreset, emptyArena, emptyInstances, emptyChain, kSampleRate, activePreset, requestedPreset);
+    CHECK(!ok && requestedPreset == activePreset && emptyChain.getActive()->length == 0,
+          "boot failure: ok %d, request %d, active %d", ok, requestedPreset, activePreset);
+}
+
+int main() {
+    testFuzz();
+    testArenaFull();
+    return testResult("test_fxchain");
+}
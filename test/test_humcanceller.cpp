@@ -0,0 +1,146 @@
+#include "test_common.h"
+
+// HumCanceller: locks onto drifted 50/60Hz mains, suppression of each harmonic on synthetic DI,
+// notes don't drag the tracker, bypass is bit exact, and cost per block
+
+const double kSampleRate = 48000.0;
+const int kBlockSize = 4;
+const int kNumHarmonics = 4;
+
+// synthetic DI: mains hum (fundamental at -54dBFS, under the quiet_dB gate) and hiss, plus notes when playing
+struct DI {
+    double mains;
+    TestNoise noise;
+    long n = 0;
+    bool playing = false;
+
+    double hum(long i) {
+        const double levels[kNumHarmonics] = { 0.002, 0.001, 0.0006, 0.0004 };
+        double t = i / kSampleRate, y = 0.0;
+        for (int h = 0; h < kNumHarmonics; h++)
+            y += levels[h] * sin(2.0 * kPi * (h + 1) * mains * t + h);
+        return y;
+    }
+
+    double next(double& humOnly) {
+        humOnly = hum(n);
+        double t = n / kSampleRate, y = humOnly + 0.0003 * noise.next();
+        if (playing) {
+            // low E, A, D every half second, plucked
+            const double notes[] = { 41.2, 55.0, 73.4 };
+            double tn = fmod(t, 0.5);
+            double f = notes[(long)(t / 0.5) % 3];
+            for (int h = 1; h <= 4; h++) y += 0.3 / h * sin(2.0 * kPi * h * f * tn) * exp(-tn * 4.0);
+        }
+        n++;
+        return y;
+    }
+};
+
+// amplitude of x at freq (single bin DFT over the whole buffer)
+static double amplitudeAt(const double* x, int length, double freq) {
+    double re = 0.0, im = 0.0;
+    for (int i = 0; i < length; i++) {
+        double w = 2.0 * kPi * freq * i / kSampleRate;
+        re += x[i] * cos(w);
+        im -= x[i] * sin(w);
+    }
+    return 2.0 * sqrt(re * re + im * im) / length;
+}
+
+static void setup(HumCanceller& humCanceller) {
+    humCanceller.reset(kSampleRate);
+    HumCancellerParameters params = humCanceller.getParameters();
+    params.on = true;
+    params.numHarmonics = kNumHarmonics;
+    humCanceller.setParameters(params);
+}
+
+// runs seconds of di through the canceller, keeps the last second of input and output
+static void run(HumCanceller& humCanceller, DI& di, double seconds, double* in, double* out) {
+    int numBlocks = (int)(seconds * kSampleRate / kBlockSize);
+    int keepFrom = numBlocks * kBlockSize - (int)kSampleRate;
+    for (int b = 0; b < numBlocks; b++) {
+        double block[kBlockSize], humOnly;
+        for (int n = 0; n < kBlockSize; n++) block[n] = di.next(humOnly);
+        int i = b * kBlockSize - keepFrom;
+        if (i >= 0) memcpy(&in[i], block, sizeof(block));
+        humCanceller.processBlock(block, kBlockSize);
+        if (i >= 0) memcpy(&out[i], block, sizeof(block));
+    }
+}
+
+static void testSuppression(double mains) {
+    static HumCanceller humCanceller;
+    static double in[48000], out[48000];
+    setup(humCanceller);
+    DI di = { mains };
+
+    // quiet between songs: lock on (the tracker starts at 60Hz and moves ~2% of the error per cycle)
+    run(humCanceller, di, 10.0, in, out);
+    double tracked = humCanceller.getTrackedFreq();
+    CHECK(fabs(tracked - mains) < 0.05, "%.1f Hz mains tracked at %.3f Hz", mains, tracked);
+
+    double worst = 1e9;
+    printf("%.1f Hz mains, tracked %.3f Hz, suppression:", mains, tracked);
+    for (int h = 1; h <= kNumHarmonics; h++) {
+        double suppression = 20.0 * log10(amplitudeAt(in, 48000, h * mains) / amplitudeAt(out, 48000, h * mains));
+        printf(" %.1f", suppression);
+        if (suppression < worst) worst = suppression;
+    }
+    printf(" dB\n");
+    CHECK(worst > 45.0, "%.1f Hz mains: worst harmonic only %.1f dB down", mains, worst);
+
+    // playing: notes must not drag the tracker
+    di.playing = true;
+    run(humCanceller, di, 6.0, in, out);
+    CHECK(fabs(humCanceller.getTrackedFreq() - mains) < 0.05, "%.1f Hz mains: tracker dragged to %.3f Hz while playing",
+          mains, humCanceller.getTrackedFreq());
+}
+
+static void testBypass() {
+    static HumCanceller humCanceller;
+    static double in[48000], out[48000];
+    setup(humCanceller);
+    DI di = { 50.3 };
+    run(humCanceller, di, 10.0, in, out);
+
+    HumCancellerParameters params = humCanceller.getParameters();
+    params.on = false;
+    humCanceller.setParameters(params);
+    run(humCanceller, di, 1.0, in, out);
+    bool exact = memcmp(in, out, sizeof(in)) == 0;
+    CHECK(exact, "bypassed output differs from input");
+
+    // back on: fresh notch state, suppressing again
+    params.on = true;
+    humCanceller.setParameters(params);
+    run(humCanceller, di, 2.0, in, out);
+    double suppression = 20.0 * log10(amplitudeAt(in, 48000, 50.3) / amplitudeAt(out, 48000, 50.3));
+    CHECK(suppression > 45.0, "after re-enabling, fundamental only %.1f dB down", suppression);
+}
+
+static void benchmark() {
+    static HumCanceller humCanceller;
+    setup(humCanceller);
+    DI di = { 50.3 };
+    di.playing = true;
+    const int numBlocks = (int)(10 * kSampleRate / kBlockSize);
+    static double input[(int)(10 * 48000)];
+    double humOnly;
+    for (int i = 0; i < numBlocks * kBlockSize; i++) input[i] = di.next(humOnly);
+
+    double start = nowNs();
+    for (int b = 0; b < numBlocks; b++) humCanceller.processBlock(&input[b * kBlockSize], kBlockSize);
+    double ns = (nowNs() - start) / numBlocks;
+    printf("HumCanceller (%d notches): %.1f ns/block of %d, %.1f ns/sample\n", kNumHarmonics, ns, kBlockSize, ns / kBlockSize);
+    CHECK(std::isfinite(input[numBlocks * kBlockSize - 1]), "output not finite");
+}
+
+int main() {
+    testSuppression(50.3);
+    testSuppression(59.7);
+    testBypass();
+    benchmark();
+    return testResult("test_humcanceller");
+}
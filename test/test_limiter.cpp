@@ -0,0 +1,127 @@
+#include "test_common.h"
+#include <initializer_list>
+
+// LB_Limiter: no sample over the ceiling, pure delay under it, running gain sum doesn't drift,
+// LB_SlidingMax against brute force, and cost per lookahead
+
+const double kSampleRate = 48000.0;
+
+struct LimiterProbe : LB_Limiter {
+    double sumError() {
+        double exact = 0.0;
+        for (int i = 0; i < parameters.lookahead; i++) exact += gainHistory[i];
+        return fabs(gainSum - exact);
+    }
+};
+
+struct SlidingMaxProbe : LB_SlidingMax<257> {
+    void setCount(uint32_t c) { count = c; }
+};
+
+static void setupLimiter(LB_Limiter& limiter, int lookahead) {
+    limiter.reset(kSampleRate);
+    LB_LimiterParameters params = limiter.getParameters();
+    params.ceiling_dB = -0.3;
+    params.lookahead = lookahead;
+    params.releaseTime = 50.0;
+    limiter.setParameters(params);
+}
+
+// hot noise (up to +12dBFS) with full scale impulses and quiet gaps
+static double hotInput(TestNoise& noise, int n) {
+    double x = 4.0 * noise.next();
+    if (n % 4801 == 0) x = (n & 1) ? 8.0 : -8.0;
+    if ((n / 24000) % 3 == 2) x *= 0.01;
+    return x;
+}
+
+static void testNoOvers() {
+    double ceiling = pow(10.0, -0.3 / 20.0);
+    for (int L : { 1, 7, 48, 256 }) {
+        static LimiterProbe limiter;
+        setupLimiter(limiter, L);
+        TestNoise noise;
+        double worst = 0.0;
+        int overs = 0;
+        for (int n = 0; n < 48000 * 20; n++) {
+            double y = fabs(limiter.processAudioSample(hotInput(noise, n)));
+            if (y > ceiling * (1.0 + 1e-12)) overs++;
+            if (y > worst) worst = y;
+        }
+        CHECK(overs == 0, "L = %d: %d samples over the ceiling, worst %.6f", L, overs, worst);
+        CHECK(limiter.sumError() < 1e-12 * L, "L = %d: running gain sum off by %g", L, limiter.sumError());
+        printf("L = %3d: peak %.6f (ceiling %.6f), gain sum error %g\n", L, worst, ceiling, limiter.sumError());
+    }
+}
+
+static void testTransparent() {
+    // under the ceiling the limiter is a pure L sample delay
+    for (int L : { 1, 7, 48, 256 }) {
+        static LB_Limiter limiter;
+        setupLimiter(limiter, L);
+        CHECK(limiter.getLatency() == L, "getLatency %d, expected %d", limiter.getLatency(), L);
+        TestNoise noise;
+        double history[48000];
+        double worst = 0.0;
+        for (int n = 0; n < 48000; n++) {
+            history[n] = 0.5 * noise.next();
+            double y = limiter.processAudioSample(history[n]);
+            double expected = n >= L ? history[n - L] : 0.0;
+            if (fabs(y - expected) > worst) worst = fabs(y - expected);
+        }
+        CHECK(worst == 0.0, "L = %d: under the ceiling output differs from the delayed input by %g", L, worst);
+    }
+}
+
+static void testSlidingMax() {
+    TestNoise noise;
+    static double values[200000];
+    for (int window : { 1, 2, 7, 48, 49, 256, 257 }) {
+        for (uint32_t startCount : { 0u, 0xFFFFFF00u }) { //second pass runs the index counter through its wrap
+            SlidingMaxProbe slidingMax;
+            slidingMax.reset(window);
+            slidingMax.setCount(startCount);
+            int mismatches = 0;
+            for (int n = 0; n < 200000; n++) {
+                // runs of repeats and ramps, not just noise, to exercise ties and long monotonic stretches
+                double x = noise.next();
+                if ((n / 1000) % 4 == 1) x = 0.25;
+                if ((n / 1000) % 4 == 2) x = -1.0 + (n % 1000) * 0.002;
+                if ((n / 1000) % 4 == 3) x = 1.0 - (n % 1000) * 0.002;
+                values[n] = x;
+
+                double got = slidingMax.push(x);
+                double expected = x;
+                for (int k = 1; k < window && k <= n; k++)
+                    if (values[n - k] > expected) expected = values[n - k];
+                if (got != expected) mismatches++;
+            }
+            CHECK(mismatches == 0, "window %d, count from %u: %d mismatches against brute force", window, startCount, mismatches);
+        }
+    }
+}
+
+static void benchmark() {
+    static double input[48000];
+    TestNoise noise;
+    for (int n = 0; n < 48000; n++) input[n] = hotInput(noise, n);
+    for (int L : { 1, 7, 48, 256 }) {
+        static LB_Limiter limiter;
+        setupLimiter(limiter, L);
+        const int numSamples = 48000 * 20;
+        double sink = 0.0;
+        double start = nowNs();
+        for (int n = 0; n < numSamples; n++) sink += limiter.processAudioSample(input[n % 48000]);
+        double ns = (nowNs() - start) / numSamples;
+        printf("L = %3d: %5.1f ns/sample\n", L, ns);
+        CHECK(std::isfinite(sink), "output not finite");
+    }
+}
+
+int main() {
+    testNoOvers();
+    testTransparent();
+    testSlidingMax();
+    benchmark();
+    return testResult("test_limiter");
+}
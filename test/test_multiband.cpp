@@ -0,0 +1,70 @@
+#include "test_common.h"
+
+// LB_MultibandCompressor: bands sum flat with no compression, and cost against LB_Compressor
+
+static void testFlatSum() {
+    const double sampleRate = 48000;
+    LB_MultibandCompressor comp;
+    comp.reset(sampleRate);
+    LB_MultibandCompressorParameters params = comp.getParameters();
+    for (int i = 0; i < kNumCompBands; i++) params.ratio[i] = 1.0;
+    params.outputGain = 0.0;
+    comp.setParameters(params);
+
+    const double freqs[] = { 31.0, 80.0, 150.0, 300.0, 600.0, 1200.0, 2500.0, 5000.0, 10000.0 };
+    for (double f : freqs) {
+        comp.reset(sampleRate);
+        double gain = sineGain_dB([&](double x) { return comp.processAudioSample(x); }, f, sampleRate);
+        CHECK(fabs(gain) < 0.01, "%.0f Hz: %.4f dB, expected flat", f, gain);
+    }
+}
+
+static void testCompresses() {
+    // -6dBFS low note into the FatPunch style setup should come out well below the input
+    const double sampleRate = 48000;
+    LB_MultibandCompressor comp;
+    comp.reset(sampleRate);
+    comp.setParameters(comp.getParameters());
+    double gain = sineGain_dB([&](double x) { return comp.processAudioSample(x); }, 80.0, sampleRate, 0.5);
+    CHECK(gain < -10.0, "80 Hz at -6dBFS: %.2f dB, expected gain reduction", gain);
+}
+
+static void benchmark() {
+    const double sampleRate = 48000;
+    const int numSamples = 48000 * 10;
+
+    LB_Compressor single;
+    single.reset(sampleRate);
+    LB_CompressorParameters singleParams;
+    singleParams.threshold_dB = -42.0;
+    singleParams.ratio = 3.0;
+    singleParams.attackTime = 150.0;
+    singleParams.releaseTime = 20.0;
+    singleParams.outputGain = 3.0;
+    single.setParameters(singleParams);
+
+    LB_MultibandCompressor multi;
+    multi.reset(sampleRate);
+    multi.setParameters(multi.getParameters());
+
+    TestNoise noise;
+    double sink = 0.0;
+    double start = nowNs();
+    for (int n = 0; n < numSamples; n++) sink += single.processAudioSample(0.3 * noise.next());
+    double singleNs = (nowNs() - start) / numSamples;
+
+    start = nowNs();
+    for (int n = 0; n < numSamples; n++) sink += multi.processAudioSample(0.3 * noise.next());
+    double multiNs = (nowNs() - start) / numSamples;
+
+    printf("LB_Compressor          %6.1f ns/sample\n", singleNs);
+    printf("LB_MultibandCompressor %6.1f ns/sample (%.2fx, 4 bands)\n", multiNs, multiNs / singleNs);
+    if (sink == 12345.0) printf("\n"); // keep the loops
+}
+
+int main() {
+    testFlatSum();
+    testCompresses();
+    benchmark();
+    return testResult("test_multiband");
+}
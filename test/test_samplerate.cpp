@@ -0,0 +1,125 @@
+#include "test_common.h"
+
+// Sample rate switching: setSampleRate() lands on the same response as a fresh reset(), responses
+// stay put across 32/48/96kHz, and CPU cost at each rate
+
+const double kRates[] = { 32000.0, 48000.0, 96000.0 };
+const double kFreqs[] = { 40.0, 80.0, 150.0, 300.0, 700.0, 1500.0, 4000.0 };
+const int kNumFreqs = sizeof(kFreqs) / sizeof(kFreqs[0]);
+
+struct Pedal {
+    FatPunch fatPunch;
+    MelodyMode melodyMode;
+    CleanBlend cleanBlend;
+
+    void reset(double sampleRate) {
+        fatPunch.reset(sampleRate);
+        melodyMode.reset(sampleRate);
+        cleanBlend.reset(sampleRate);
+        configure();
+    }
+
+    void setSampleRate(double sampleRate) {
+        fatPunch.setSampleRate(sampleRate);
+        melodyMode.setSampleRate(sampleRate);
+        cleanBlend.setSampleRate(sampleRate);
+    }
+
+    void configure() {
+        FatPunchParameters fpParams;
+        fpParams.fatOn = true;
+        fpParams.darkenOn = true;
+        fpParams.punchCompOn = false; //level dependent, keep the path linear
+        fpParams.subLevel = 0.0;
+        fpParams.fatFreq = 0.3;
+        fpParams.darkenAmt = 0.6;
+        fatPunch.setParameters(fpParams);
+
+        MelodyModeParameters mmParams;
+        mmParams.on = true;
+        melodyMode.setParameters(mmParams);
+
+        CleanBlendParameters cbParams;
+        cbParams.mix = 0.5;
+        cleanBlend.setParameters(cbParams);
+    }
+
+    double processAudioSample(double xn) {
+        double fp = fatPunch.processAudioSample(xn);
+        double mm = melodyMode.processAudioSample(xn);
+        return cleanBlend.processAudioSample(xn, fp + mm);
+    }
+};
+
+// small signal so the waveshapers stay linear
+static void response(Pedal& pedal, double sampleRate, double* gains) {
+    for (int i = 0; i < kNumFreqs; i++)
+        gains[i] = sineGain_dB([&](double x) { return pedal.processAudioSample(x); }, kFreqs[i], sampleRate, 1e-4);
+}
+
+static void testResponses() {
+    static Pedal reference, fresh, switched;
+    double refGains[kNumFreqs];
+    reference.reset(48000.0);
+    response(reference, 48000.0, refGains);
+
+    for (double sampleRate : kRates) {
+        fresh.reset(sampleRate);
+        switched.reset(48000.0);
+        switched.setSampleRate(sampleRate);
+
+        double freshGains[kNumFreqs], switchedGains[kNumFreqs];
+        response(fresh, sampleRate, freshGains);
+        response(switched, sampleRate, switchedGains);
+
+        for (int i = 0; i < kNumFreqs; i++) {
+            CHECK(fabs(switchedGains[i] - freshGains[i]) < 0.01,
+                  "%.0fHz: setSampleRate %.3f dB vs reset %.3f dB at %.0f Hz", sampleRate, switchedGains[i], freshGains[i], kFreqs[i]);
+            CHECK(fabs(freshGains[i] - refGains[i]) < 0.5,
+                  "%.0fHz: %.3f dB vs %.3f dB at 48kHz, %.0f Hz", sampleRate, freshGains[i], refGains[i], kFreqs[i]);
+        }
+        printf("%5.0f Hz response:", sampleRate);
+        for (int i = 0; i < kNumFreqs; i++) printf(" %6.2f", freshGains[i]);
+        printf(" dB\n");
+    }
+}
+
+static void benchmark() {
+    static Pedal pedal;
+    static LB_Limiter limiter;
+    static HumCanceller humCanceller;
+    for (double sampleRate : kRates) {
+        pedal.reset(sampleRate);
+        FatPunchParameters fpParams = pedal.fatPunch.getParameters();
+        fpParams.punchCompOn = true;
+        pedal.fatPunch.setParameters(fpParams);
+        humCanceller.reset(sampleRate);
+        limiter.reset(sampleRate);
+        LB_LimiterParameters limiterParams = limiter.getParameters();
+        limiterParams.lookahead = (int)(sampleRate * 0.001);
+        limiter.setParameters(limiterParams);
+
+        const int kBlock = 4;
+        const int numBlocks = (int)sampleRate * 2 / kBlock;
+        TestNoise noise;
+        double block[kBlock];
+        double sink = 0.0;
+        double start = nowNs();
+        for (int b = 0; b < numBlocks; b++) {
+            for (int n = 0; n < kBlock; n++) block[n] = 0.05 * noise.next();
+            humCanceller.processBlock(block, kBlock);
+            for (int n = 0; n < kBlock; n++)
+                sink += limiter.processAudioSample(pedal.processAudioSample(block[n]));
+        }
+        double nsPerSample = (nowNs() - start) / (numBlocks * kBlock);
+        printf("%5.0f Hz: %6.1f ns/sample, %5.2f%% of one host core in real time\n",
+               sampleRate, nsPerSample, nsPerSample * sampleRate * 1e-7);
+        CHECK(std::isfinite(sink), "%.0fHz output not finite", sampleRate);
+    }
+}
+
+int main() {
+    testResponses();
+    benchmark();
+    return testResult("test_samplerate");
+}
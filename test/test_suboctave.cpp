@@ -0,0 +1,96 @@
+#include "test_common.h"
+
+// LB_SubOctave: tracks exactly one octave down over the 5 string range, and what it costs
+
+const double kSampleRate = 48000.0;
+
+// plucked bass-like note, strong 2nd harmonic (the usual way octave trackers go wrong)
+static double pluck(double freq, int n) {
+    double t = n / kSampleRate;
+    const double harmonics[] = { 1.0, 0.8, 0.5, 0.35, 0.25, 0.15 };
+    double y = 0.0;
+    for (int h = 0; h < 6; h++)
+        y += harmonics[h] * sin(2.0 * kPi * (h + 1) * freq * t) * exp(-t * (0.8 + 0.5 * h));
+    return 0.2 * y;
+}
+
+// frequency of the output from its rising zero crossings (interpolated) after settling
+static double measureSubFreq(double freq) {
+    LB_SubOctave sub;
+    sub.reset(kSampleRate);
+    sub.setParameters(sub.getParameters());
+
+    int settle = (int)(0.3 * kSampleRate), total = (int)(2.3 * kSampleRate);
+    double prev = 0.0, firstCross = -1.0, lastCross = -1.0;
+    int crossings = 0;
+    for (int n = 0; n < total; n++) {
+        double y = sub.processAudioSample(pluck(freq, n));
+        if (n > settle && prev < 0.0 && y >= 0.0) {
+            double t = (n - 1 + prev / (prev - y)) / kSampleRate;
+            if (firstCross < 0.0) firstCross = t;
+            lastCross = t;
+            crossings++;
+        }
+        prev = y;
+    }
+    if (crossings < 2) return 0.0;
+    return (crossings - 1) / (lastCross - firstCross);
+}
+
+static void testTracking() {
+    // open B E A D G of a 5 string, up to the 12th fret G
+    const int notes[] = { 23, 28, 33, 38, 43, 48, 55 };
+    double worst = 0.0;
+    for (int midi : notes) {
+        double freq = 440.0 * pow(2.0, (midi - 69) / 12.0);
+        double ratio = freq / measureSubFreq(freq);
+        CHECK(fabs(ratio - 2.0) < 0.002, "note %d (%.2f Hz): in/out ratio %.4f", midi, freq, ratio);
+        if (fabs(ratio - 2.0) > worst) worst = fabs(ratio - 2.0);
+    }
+    printf("sub octave: worst in/out ratio error %.5f over B0-G3\n", worst);
+}
+
+static void benchmark() {
+    const int numSamples = (int)kSampleRate * 10;
+    LB_SubOctave sub;
+    sub.reset(kSampleRate);
+    sub.setParameters(sub.getParameters());
+
+    static FatPunch fatPunch, fatPunchSub;
+    fatPunch.reset(kSampleRate);
+    fatPunchSub.reset(kSampleRate);
+    FatPunchParameters params;
+    params.fatOn = true;
+    params.darkenOn = false;
+    params.punchCompOn = false;
+    params.subLevel = 0.0;
+    fatPunch.setParameters(params);
+    params.subLevel = 0.4;
+    fatPunchSub.setParameters(params);
+
+    static double input[48000];
+    for (int n = 0; n < 48000; n++) input[n] = pluck(41.2, n);
+
+    double sink = 0.0;
+    double start = nowNs();
+    for (int n = 0; n < numSamples; n++) sink += sub.processAudioSample(input[n % 48000]);
+    double subNs = (nowNs() - start) / numSamples;
+
+    start = nowNs();
+    for (int n = 0; n < numSamples; n++) sink += fatPunch.processAudioSample(input[n % 48000]);
+    double fatNs = (nowNs() - start) / numSamples;
+
+    start = nowNs();
+    for (int n = 0; n < numSamples; n++) sink += fatPunchSub.processAudioSample(input[n % 48000]);
+    double fatSubNs = (nowNs() - start) / numSamples;
+
+    printf("LB_SubOctave     %6.1f ns/sample\n", subNs);
+    printf("FatPunch fat     %6.1f ns/sample, with sub %6.1f ns/sample\n", fatNs, fatSubNs);
+    CHECK(std::isfinite(sink), "output not finite");
+}
+
+int main() {
+    testTracking();
+    benchmark();
+    return testResult("test_suboctave");
+}
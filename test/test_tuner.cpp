@@ -0,0 +1,106 @@
+#include "test_common.h"
+
+// Tuner: accuracy and time to lock over the bass range, on clean synthetic notes and on synthetic DI
+// (stretched partials, pick noise, hum, hiss), plus clear() dropping an estimate that was in flight
+
+const double kSampleRate = 48000.0;
+const int kBlockSize = 4;
+
+struct Note {
+    double freq;
+    bool di; //synthetic DI: inharmonic partials, pick transient, hum, noise
+    TestNoise noise;
+    int n = 0;
+
+    double next() {
+        double t = n++ / kSampleRate;
+        double inharmonicity = di ? 0.0002 : 0.0; //typical for wound bass strings
+        double y = 0.0;
+        for (int h = 1; h <= 6; h++) {
+            double fh = h * freq * sqrt((1.0 + inharmonicity * h * h) / (1.0 + inharmonicity)); //fundamental stays at freq
+            y += sin(2.0 * kPi * fh * t) * exp(-t * (0.5 + 0.4 * h)) / h;
+        }
+        y *= 0.3;
+        if (di) {
+            y += 0.3 * noise.next() * exp(-t * 200.0); //pick
+            y += 0.003 * sin(2.0 * kPi * 60.0 * t);     //hum
+            y += 0.002 * noise.next();                  //hiss
+        }
+        return y;
+    }
+};
+
+static double noteFreq(int midi, double cents) {
+    return 440.0 * pow(2.0, (midi - 69 + cents / 100.0) / 12.0);
+}
+
+// plays a note like the callback/main loop pair would, returns ms to lock (-1 if never)
+static double playNote(Tuner& tuner, Note& note, double seconds) {
+    double lockMs = -1.0;
+    int numBlocks = (int)(seconds * kSampleRate / kBlockSize);
+    for (int b = 0; b < numBlocks; b++) {
+        for (int n = 0; n < kBlockSize; n++) tuner.pushAudioSample(note.next());
+        tuner.update();
+        if (lockMs < 0.0 && tuner.isLocked()) lockMs = (b + 1) * kBlockSize * 1000.0 / kSampleRate;
+    }
+    return lockMs;
+}
+
+static void testAccuracy() {
+    // B0 E1 A1 D2 G2 C3 (5 string + 6 string high C), in tune and off by +/-20 cents
+    const int notes[] = { 23, 28, 33, 38, 43, 48 };
+    const double offsets[] = { 0.0, 20.0, -20.0 };
+    static Tuner tuner;
+
+    for (int di = 0; di < 2; di++) {
+        double worstCents = 0.0, worstLockMs = 0.0;
+        for (int midi : notes) {
+            for (double offset : offsets) {
+                tuner.reset(kSampleRate);
+                Note note = { noteFreq(midi, offset), di == 1 };
+                double lockMs = playNote(tuner, note, 0.5);
+
+                double err = fabs(tuner.getCents() - offset);
+                CHECK(lockMs > 0.0, "%s note %d %+.0f cents never locked", di ? "DI" : "clean", midi, offset);
+                CHECK(tuner.getNoteNum() == midi, "%s note %d %+.0f cents read as note %d",
+                      di ? "DI" : "clean", midi, offset, tuner.getNoteNum());
+                // stretched DI partials pull YIN a little sharp of the fundamental
+                CHECK(err < (di ? 2.5 : 1.0), "%s note %d %+.0f cents read %+.2f cents",
+                      di ? "DI" : "clean", midi, offset, tuner.getCents());
+                if (err > worstCents) worstCents = err;
+                if (lockMs > worstLockMs) worstLockMs = lockMs;
+            }
+        }
+        CHECK(worstLockMs < 150.0, "%s notes took %.0f ms to lock", di ? "DI" : "clean", worstLockMs);
+        printf("%-5s notes: worst error %.2f cents, worst time to lock %.0f ms\n", di ? "DI" : "clean", worstCents, worstLockMs);
+    }
+}
+
+static void testClearCancels() {
+    static Tuner tuner;
+    tuner.reset(kSampleRate);
+    Note a = { noteFreq(33, 0.0), false };
+    playNote(tuner, a, 0.3);
+    CHECK(tuner.getNoteNum() == 33, "setup: A1 read as note %d", tuner.getNoteNum());
+
+    // one more hop of A and a single update, so an A estimate is left half done
+    for (int n = 0; n < 128 * 8; n++) tuner.pushAudioSample(a.next());
+    tuner.update();
+
+    // leave and re-enter tuner mode, now playing D2. The first reading must be D2, not the stale A1
+    tuner.clear();
+    Note d = { noteFreq(38, 0.0), false };
+    int firstNote = -1;
+    for (int b = 0; b < 48000 / kBlockSize && firstNote < 0; b++) {
+        for (int n = 0; n < kBlockSize; n++) tuner.pushAudioSample(d.next());
+        tuner.update();
+        firstNote = tuner.getNoteNum();
+    }
+    CHECK(firstNote == 38, "first reading after clear() was note %d, expected 38", firstNote);
+}
+
+int main() {
+    testAccuracy();
+    testClearCancels();
+    return testResult("test_tuner");
+}
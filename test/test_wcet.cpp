@@ -0,0 +1,274 @@
+#include "test_common.h"
+#include "../FXObjects/BassPedalEngine.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+/*
+Host WCET harness for the audio callback. Runs BassPedalEngine::processBlock, the same code Callback
+in BassPedal.cpp runs, with random knob moves, footswitch taps and holds (hum canceller bypass, preset
+step, calibration, tuner) and pathological input: silence tails after notes, DC, full scale square,
+impulses, hot noise, all over drifting mains hum, alone between notes so the hum notches get retuned.
+
+Every block is timed in ns and binned by mode (fat, darken, punch, melody, tuner bits, same as the
+firmware profiler). The whole deterministic sequence is run kRuns times and each block keeps its
+fastest run, so host preemption doesn't show up as WCET. Modes over the limit get up to kAttempts
+rounds of kRuns.
+
+Each mode's WCET is compared against kBaseline, stored in units of a fixed reference workload timed
+alongside it (Reference), so the gate follows the host's speed. Fails if any mode goes over
+kMargin x its baseline, or reaches a mode with no baseline.
+
+    test_wcet              check against kBaseline
+    test_wcet --baseline   print a new kBaseline table, after a deliberate change to the callback cost
+*/
+
+const double kSampleRate = 48000.0;
+const int kBlockSize = 4;
+const int kNumModes = 32;
+const int kRuns = 5;
+const int kAttempts = 3;
+const double kSeconds = 40.0;
+const int kNumBlocks = (int)(kSeconds * kSampleRate / kBlockSize);
+const double kBlockMs = 1000.0 * kBlockSize / kSampleRate;
+
+// Per mode WCET in reference workload units (see Reference), the worst of a few --baseline runs.
+// 0 = mode not reached by the sequence
+const double kMargin = 1.5;
+const double kBaseline[kNumModes] = {
+    15.2, 21.6, 15.2, 18.6, 20.4, 24.4, 21.6, 24.2,
+    12.7, 12.9, 13.3, 13.5, 20.8, 17.4, 13.2, 17.4,
+    4.4, 15.3, 11.2, 12.1, 10.5, 10.3, 13.3, 4.9,
+    4.1, 3.7, 0.0, 0.0, 4.0, 0.0, 2.6, 0.0,
+};
+
+// Fixed reference workload, independent of the FX code (so a slower callback can't hide in it): a 16
+// section biquad cascade over one block. Timed right after every callback, under the same cache and
+// host conditions, and each block's callback time is divided by it. Its median only converts back to ns
+struct Reference {
+    static const int kSections = 16;
+    double state[kSections][2] = { { 0.0 } };
+    double sink = 0.0;
+
+    void processBlock(const float* in) {
+        for (int n = 0; n < kBlockSize; n++) {
+            double x = in[2 * n];
+            for (int s = 0; s < kSections; s++) {
+                double y = 0.2 * x + state[s][0];
+                state[s][0] = 0.4 * x - 0.5 * y + state[s][1];
+                state[s][1] = 0.2 * x - 0.25 * y;
+                x = y;
+            }
+            sink += x;
+        }
+    }
+};
+
+// Deterministic input: a sequence of segments, each one of the pathological cases
+struct Signal {
+    enum Kind { note, silence, dc, square, impulses, noise, hum, numKinds };
+    TestNoise rng;
+    Kind kind = note;
+    int remaining = 0, n = 0;
+    double freq = 41.2, level = 0.3;
+    TestNoise hiss;
+    double mainsPhase = 0.0;
+
+    float next() {
+        if (--remaining <= 0) {
+            kind = (Kind)((int)((rng.next() * 0.5 + 0.5) * numKinds) % numKinds);
+            remaining = (int)((0.2 + 1.8 * (rng.next() * 0.5 + 0.5)) * kSampleRate);
+            freq = 30.87 * pow(2.0, 2.5 * (rng.next() * 0.5 + 0.5)); //B0 to ~E3
+            level = rng.next() > 0.0 ? 1.0 : 0.01 + 0.3 * (rng.next() * 0.5 + 0.5);
+            n = 0;
+        }
+        double t = n++ / kSampleRate;
+        double humNow = mainsHum(t);
+        switch (kind) {
+            case note: return (float)(level * sin(2.0 * kPi * freq * t) * exp(-t * 3.0) + humNow);
+            case silence: return 0.0f; //whatever came before decays into denormal territory
+            case dc: return (float)((level > 0.5 ? 1.0 : level) + humNow);
+            case square: return fmod(t * freq, 1.0) < 0.5 ? 1.0f : -1.0f;
+            case impulses: return (float)((n % 997 == 1 ? (rng.next() > 0.0 ? 1.0 : -1.0) : 0.0) + humNow);
+            case hum: return (float)humNow; //between notes, the hum tracker follows and retunes the notches
+            default: return (float)(level * rng.next());
+        }
+    }
+
+    // 50Hz mains wandering +-2% and hiss under the playing, quiet enough on its own for the hum tracker
+    double mainsHum(double t) {
+        double mains = 50.0 * (1.0 + 0.02 * sin(2.0 * kPi * 0.3 * t));
+        mainsPhase = fmod(mainsPhase + mains / kSampleRate, 1.0);
+        double y = 0.0001 * hiss.next();
+        for (int h = 1; h <= 4; h++) y += 0.0006 / h * sin(2.0 * kPi * h * mainsPhase);
+        return y;
+    }
+};
+
+// Deterministic UI: knobs wander and sometimes jump, footswitches get tapped and held
+struct UI {
+    TestNoise rng;
+    PedalControls c;
+    float pressMs[numFootswitches] = { 0.0f }; //how long the current press lasts, 0 = up
+
+    PedalControls next() {
+        float* knobs[6] = { &c.inputTrim, &c.mix, &c.fatFreq, &c.darken, &c.midFreq, &c.sub };
+        for (int k = 0; k < 6; k++) {
+            float& knob = *knobs[k];
+            knob += 0.001f * (float)rng.next(); //ADC noise/slow turns
+            if (rng.next() > 0.9995) knob = (float)(rng.next() * 0.5 + 0.5); //fast sweep
+            knob = knob < 0.0f ? 0.0f : (knob > 1.0f ? 1.0f : knob);
+        }
+        // each footswitch gets pressed roughly every 150ms, mostly taps, sometimes held past 1s
+        for (int i = 0; i < numFootswitches; i++) {
+            if (c.pressed[i]) {
+                c.timeHeldMs[i] += (float)kBlockMs;
+                if (c.timeHeldMs[i] >= pressMs[i]) c.pressed[i] = false;
+            }
+            else if (rng.next() > 0.9985) {
+                c.pressed[i] = true;
+                c.timeHeldMs[i] = 0.0f;
+                bool hold = rng.next() > (i == fsMelody ? 0.9 : 0.8);
+                pressMs[i] = (float)(hold ? 1100.0 + 400.0 * (rng.next() * 0.5 + 0.5)
+                                          : 50.0 + 300.0 * (rng.next() * 0.5 + 0.5));
+            }
+        }
+        return c;
+    }
+};
+
+static float inputs[kNumBlocks][2 * kBlockSize];
+static PedalControls controls[kNumBlocks];
+static double cost[kNumBlocks];    //fastest callback time so far per block, in reference workload units
+static double refCost[kNumBlocks]; //fastest reference workload time so far per block, ns
+static int modes[kNumBlocks];
+
+// what the sequence reached, the slow paths have to be in the timing
+struct Coverage {
+    int humToggles = 0, humMoves = 0, presetSteps = 0;
+    bool nonFinite = false;
+};
+
+// kRuns fresh pedals through the whole sequence, each block keeps its fastest time
+static void measure(Coverage& coverage) {
+    for (int run = 0; run < kRuns; run++) {
+        static BassPedalEngine<kBlockSize> pedal;
+        static Reference reference;
+        new (&pedal) BassPedalEngine<kBlockSize>();
+        CHECK(pedal.init(kSampleRate), "effects don't fit in the arena");
+
+        float out[2 * kBlockSize];
+        PedalDisplay display;
+        for (int b = 0; b < kNumBlocks; b++) {
+            bool humWasOn = pedal.humCanceller.getParameters().on;
+            double trackedFreq = pedal.humCanceller.getTrackedFreq();
+            int preset = pedal.activePreset;
+
+            double start = nowNs();
+            pedal.processBlock(inputs[b], out, 2 * kBlockSize, controls[b], display);
+            double ns = nowNs() - start;
+            modes[b] = pedal.getMode();
+
+            // main loop work, not timed
+            pedal.update();
+
+            start = nowNs();
+            reference.processBlock(inputs[b]);
+            double refNs = nowNs() - start;
+
+            // in reference units, the host's speed at that moment cancels out
+            cost[b] = std::min(cost[b], ns / refNs);
+            refCost[b] = std::min(refCost[b], refNs);
+
+            for (int n = 0; n < 2 * kBlockSize; n++)
+                if (!std::isfinite(out[n])) coverage.nonFinite = true;
+            if (run == 0) {
+                coverage.humToggles += pedal.humCanceller.getParameters().on != humWasOn;
+                coverage.humMoves += pedal.humCanceller.getTrackedFreq() != trackedFreq;
+                coverage.presetSteps += pedal.activePreset != preset;
+            }
+        }
+    }
+}
+
+// per mode WCET and percentiles against the baseline (in reference units). Returns the number of
+// modes over it, fills newBaseline
+static int checkBaseline(bool print, double* newBaseline) {
+    std::vector<double> refCosts(refCost, refCost + kNumBlocks);
+    std::nth_element(refCosts.begin(), refCosts.begin() + kNumBlocks / 2, refCosts.end());
+    double refNs = refCosts[kNumBlocks / 2];
+
+    if (print) {
+        printf("reference workload %.0f ns, block period %.1f us, margin %.1fx\n", refNs, 1000.0 * kBlockMs, kMargin);
+        printf("mode  fat dark punch melody tuner   blocks    p50     p99   p99.9     max  limit (ns)\n");
+    }
+    int over = 0;
+    double worst = 0.0;
+    for (int mode = 0; mode < kNumModes; mode++) {
+        newBaseline[mode] = 0.0;
+        std::vector<double> costs;
+        for (int b = 0; b < kNumBlocks; b++)
+            if (modes[b] == mode) costs.push_back(cost[b]);
+        if (costs.empty()) continue;
+        std::sort(costs.begin(), costs.end());
+        size_t count = costs.size();
+        double maxCost = costs[count - 1];
+        double limit = kMargin * kBaseline[mode];
+        newBaseline[mode] = maxCost;
+        worst = std::max(worst, maxCost);
+        if (maxCost > limit) over++;
+        if (print)
+            printf("%4d  %3d %4d %5d %6d %5d  %7d %6.0f %7.0f %7.0f %7.0f %6.0f%s\n", mode,
+                   mode & 1, (mode >> 1) & 1, (mode >> 2) & 1, (mode >> 3) & 1, (mode >> 4) & 1, (int)count,
+                   costs[count / 2] * refNs, costs[(size_t)(count * 0.99)] * refNs,
+                   costs[(size_t)(count * 0.999)] * refNs, maxCost * refNs, limit * refNs,
+                   maxCost > limit ? (kBaseline[mode] > 0.0 ? "  OVER" : "  NO BASELINE") : "");
+    }
+    if (print) printf("WCET %.0f ns\n", worst * refNs);
+    return over;
+}
+
+int main(int argc, char** argv) {
+    bool printBaseline = argc > 1 && strcmp(argv[1], "--baseline") == 0;
+
+    Signal signal;
+    UI ui;
+    for (int b = 0; b < kNumBlocks; b++) {
+        for (int n = 0; n < kBlockSize; n++) inputs[b][2 * n] = inputs[b][2 * n + 1] = signal.next();
+        controls[b] = ui.next();
+        cost[b] = refCost[b] = 1e30;
+    }
+
+    // A mode over its limit gets another kRuns (keeping each block's fastest time) before it counts,
+    // so a noisy spell on the host doesn't fail the test. A real regression stays over.
+    // --baseline always takes every attempt, for the quietest numbers
+    Coverage coverage;
+    double newBaseline[kNumModes];
+    int over = 0;
+    for (int attempt = 0; attempt < kAttempts; attempt++) {
+        measure(coverage);
+        over = checkBaseline(false, newBaseline);
+        if (over == 0 && !printBaseline) break;
+    }
+    CHECK(!coverage.nonFinite, "non finite output");
+
+    // the sequence has to reach the slow paths: hum bypass toggles, notch retunes, preset changes
+    printf("hum canceller toggled %d times, tracked mains moved in %d blocks, %d preset changes\n",
+           coverage.humToggles, coverage.humMoves, coverage.presetSteps);
+    CHECK(coverage.humToggles > 0 && coverage.humMoves > 0 && coverage.presetSteps > 0,
+          "sequence misses the hum/preset paths");
+
+    checkBaseline(true, newBaseline);
+    if (printBaseline) {
+        printf("const double kBaseline[kNumModes] = {\n");
+        for (int mode = 0; mode < kNumModes; mode++)
+            printf("%s%.1f,%s", mode % 8 == 0 ? "    " : " ", newBaseline[mode], mode % 8 == 7 ? "\n" : "");
+        printf("};\n");
+    }
+    else {
+        CHECK(over == 0, "%d modes over %.1fx their baseline WCET (or without one) after %d x %d runs", over,
+              kMargin, kAttempts, kRuns);
+    }
+
+    return testResult("test_wcet");
+}